@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace Luxora {
+
+/// Allocates storage aligned to a cache line, so kernels over values start on a vector register boundary.
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const {
+        return true;
+    }
+};
+
+/// Contiguous values aligned to 64 bytes.
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/**
+ * Packed bits, one per value of a column, set for values that are present.
+ *
+ * Bits past size() are always zero, so whole words can be compared and counted.
+ */
+class Bitmap {
+    AlignedVector<uint64_t> words;
+    size_t                  bits = 0;
+
+  public:
+    Bitmap() = default;
+    explicit Bitmap(size_t n, bool value = false) {
+        resize(n, value);
+    }
+
+    size_t size() const {
+        return bits;
+    }
+    bool operator[](size_t i) const {
+        return words[i / 64] >> (i % 64) & 1;
+    }
+    /// Word with bits of values [64 * k, 64 * k + 64).
+    uint64_t word(size_t k) const {
+        return words[k];
+    }
+    /// All words, for kernels that take 64 values at a time.
+    const uint64_t* data() const {
+        return words.data();
+    }
+
+    void set(size_t i, bool value) {
+        uint64_t mask = uint64_t(1) << (i % 64);
+        words[i / 64] = value ? words[i / 64] | mask : words[i / 64] & ~mask;
+    }
+    void push_back(bool value) {
+        if (bits % 64 == 0) {
+            words.push_back(0);
+        }
+        words.back() |= uint64_t(value) << (bits % 64);
+        ++bits;
+    }
+    void resize(size_t n, bool value = false) {
+        size_t old = bits;
+        words.resize((n + 63) / 64);
+        bits = n;
+        if (value && n > old) {
+            if (old % 64) {
+                words[old / 64] |= ~uint64_t(0) << (old % 64);
+            }
+            std::fill(words.begin() + (old + 63) / 64, words.end(), ~uint64_t(0));
+        }
+        trim();
+    }
+    void reserve(size_t n) {
+        words.reserve((n + 63) / 64);
+    }
+    void clear() {
+        words.clear();
+        bits = 0;
+    }
+
+    /// Bits of tail after the last one.
+    void append(const Bitmap& tail) {
+        size_t shift = bits % 64;
+        if (shift == 0) {
+            words.insert(words.end(), tail.words.begin(), tail.words.end());
+        } else {
+            for (uint64_t word : tail.words) {
+                words.back() |= word << shift;
+                words.push_back(word >> (64 - shift));
+            }
+        }
+        bits += tail.bits;
+        words.resize((bits + 63) / 64);
+    }
+
+    /// Number of set bits.
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t word : words) {
+            n += std::popcount(word);
+        }
+        return n;
+    }
+
+    bool operator==(const Bitmap& other) const = default;
+
+  private:
+    void trim() {
+        if (bits % 64) {
+            words.back() &= (uint64_t(1) << (bits % 64)) - 1;
+        }
+    }
+};
+
+} // namespace Luxora
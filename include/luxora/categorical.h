@@ -0,0 +1,153 @@
+#pragma once
+
+#include "luxora/bitmap.h"
+#include "luxora/parse.h"
+#include "luxora/series.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace Luxora {
+
+/// Hash of strings that also finds std::string_view keys without copying them.
+struct StringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view s) const {
+        return std::hash<std::string_view>{}(s);
+    }
+};
+
+/// Code of every distinct string.
+using CodeMap = std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>>;
+
+/**
+ * Text column with few distinct values, stored as codes into a dictionary of categories.
+ *
+ * Codes are 1, 2 or 4 bytes wide, the narrowest that fits every category. Missing values have code 0
+ * and a cleared bit in validity. Copies share the dictionary until one of them gains a category.
+ */
+class Categorical : public SeriesUntyped {
+    using Codes = std::variant<AlignedVector<uint8_t>, AlignedVector<uint16_t>, AlignedVector<uint32_t>>;
+
+    std::shared_ptr<const std::vector<std::string>> categories_;
+    Codes                                           codes;
+    Bitmap                                          validity_;
+
+  public:
+    Categorical();
+    /**
+     * @param categories Distinct values.
+     * @param codes Index of the category of every value, 0 for missing ones.
+     */
+    Categorical(std::vector<std::string> categories, std::span<const uint32_t> codes, Bitmap validity);
+    /// Encode strings, categories are numbered in order of first occurrence.
+    explicit Categorical(const Series<std::string>& strings);
+
+    /// Values as plain strings.
+    Series<std::string> decode() const;
+    /// Parse every category once into a number, values that are not numbers become missing.
+    template <typename U>
+    Series<U> parse() const;
+
+    ///
+    const std::vector<std::string>& categories() const {
+        return *categories_;
+    }
+    /// Code of the value at index, 0 for missing values.
+    uint32_t code(size_t index) const {
+        return std::visit([index](const auto& c) -> uint32_t { return c[index]; }, codes);
+    }
+    /// Whether the value at index is present.
+    bool valid(size_t index) const {
+        return validity_[index];
+    }
+    /// Category of the value at index, none for a missing value.
+    std::optional<std::string_view> view_at(size_t index) const {
+        if (!valid(index)) {
+            return {};
+        }
+        return (*categories_)[code(index)];
+    }
+    /// Code of a category, none if it is not in the dictionary.
+    std::optional<uint32_t> find(std::string_view category) const;
+
+    /// Rows whose value equals category, only codes are compared.
+    std::vector<size_t> indices_of(std::string_view category) const;
+    /// Number of values of every category, indexed by code.
+    std::vector<size_t> counts() const;
+    /// Rows of every category, indexed by code.
+    std::vector<std::vector<size_t>> groups() const;
+    /// Counts non missing values.
+    size_t count() const {
+        return validity_.count();
+    }
+
+    std::byte*       data() override;
+    const std::byte* data() const override;
+    size_t           size() const override;
+    std::type_index  type() const override {
+        return typeid(Categorical);
+    }
+    /// Width of a code.
+    size_t type_size() const override;
+
+    std::optional<std::string> string_at(size_t index) const override;
+    void                       write_at(std::ostream& os, size_t index, std::string_view none) const override;
+
+    /// Categories of tail join the dictionary, Series<std::string> is encoded.
+    void append(SeriesUntyped&& tail) override;
+    bool accepts(std::type_index type) const override {
+        return type == typeid(Categorical) || type == typeid(std::string);
+    }
+    void reserve(size_t n) override;
+
+    /// Equal values, dictionaries may differ.
+    bool operator==(const Categorical& other) const;
+
+  private:
+    /// Code of every category.
+    CodeMap known() const;
+    /// Codes of the categories of tail in this dictionary, new categories are added to it.
+    std::vector<uint32_t> remap(const std::vector<std::string>& tail);
+    /// Add values of strings after the last one.
+    void encode(const Series<std::string>& strings);
+    /// Extend the dictionary, categories must be new.
+    void add_categories(std::vector<std::string>&& added);
+    /// Add values after the last one, codes are widened first if the dictionary outgrew them.
+    void push(std::span<const uint32_t> tail, const Bitmap& validity);
+    /// Move codes to a width that fits every category.
+    void widen();
+};
+
+template <typename U>
+Series<U> Categorical::parse() const {
+    std::vector<std::optional<U>> parsed(categories_->size());
+    for (size_t k = 0; k < parsed.size(); ++k) {
+        parsed[k] = parse_number<U>((*categories_)[k]);
+    }
+    AlignedVector<U> values(size());
+    Bitmap           validity(size());
+    for (size_t i = 0; i < size(); ++i) {
+        if (!valid(i)) {
+            continue;
+        }
+        if (const auto& x = parsed[code(i)]) {
+            values[i] = *x;
+            validity.set(i, true);
+        }
+    }
+    return Series<U>(std::move(values), std::move(validity));
+}
+
+} // namespace Luxora
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "luxora/csv.h"
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Luxora {
+
+/// Compression format of an input.
+enum class Compression {
+    None, ///<
+    Gzip, ///< Also plain zlib streams and concatenated gzip members.
+    Zstd, ///<
+};
+
+/// Detect the format from the first bytes of an input.
+Compression detect_compression(std::string_view head);
+
+/// Whether the library was built with support for a format.
+bool compression_supported(Compression compression);
+
+/**
+ * Decompresses a file on a dedicated thread into a ring of buffers.
+ *
+ * The consumer takes filled buffers in order while the worker fills the free ones,
+ * so decompression runs ahead of the consumer by at most the number of buffers.
+ * Uncompressed files are passed through in buffer sized pieces.
+ */
+class Decompressor {
+    MappedFile                  input;
+    Compression                 compression;
+    std::vector<std::string>    ring;
+    std::vector<size_t>         filled;
+    size_t                      produced = 0; ///< Buffers filled by the worker.
+    size_t                      consumed = 0; ///< Buffers handed back by the consumer.
+    bool                        holding  = false;
+    bool                        finished = false;
+    std::exception_ptr          error;
+    std::mutex                  mutex;
+    std::condition_variable_any changed;
+    std::jthread                worker;
+
+  public:
+    /**
+     * @param buffer_size Size of every buffer of the ring.
+     * @param buffers Number of buffers, at least 2 so that the worker and the consumer can run at the same time.
+     *
+     * @throws std::runtime_error if the file can not be opened or its format is not supported.
+     */
+    Decompressor(const std::string& filename, size_t buffer_size = 1 << 20, size_t buffers = 4);
+    ~Decompressor();
+
+    Decompressor(const Decompressor&)            = delete;
+    Decompressor& operator=(const Decompressor&) = delete;
+
+    ///
+    Compression format() const {
+        return compression;
+    }
+
+    /**
+     * Wait for the next piece of decompressed content.
+     *
+     * The returned view stays valid until the next call, its buffer is then given back to the worker.
+     *
+     * @returns Empty view at the end of the input.
+     *
+     * @throws std::runtime_error if the input is corrupted.
+     */
+    std::string_view next();
+
+  private:
+    void run(std::stop_token stop);
+};
+
+} // namespace Luxora
@@ -0,0 +1,459 @@
+#pragma once
+
+#include "luxora/categorical.h"
+#include "luxora/series.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Luxora {
+
+/**
+ * Read-only view of a whole file mapped into memory.
+ *
+ * Cells are tokenized in place, so the file content is never copied into an intermediate document.
+ */
+class MappedFile {
+    const char* begin = nullptr;
+    size_t      length = 0;
+
+  public:
+    MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) noexcept;
+
+    std::string_view view() const {
+        return {begin, length};
+    }
+
+    /// Drop pages fully inside an already processed range of view() from memory, they are read again on access.
+    void release(std::string_view processed) const;
+};
+
+/// Cell values that stand for missing values. The empty cell is always one of them.
+class NaTokens {
+    std::vector<std::string> tokens;
+    /// Bit i is set when a token of length i exists, longer tokens share the last bit.
+    uint64_t lengths = 1;
+
+  public:
+    NaTokens() = default;
+    NaTokens(std::vector<std::string> tokens);
+
+    bool contains(std::string_view cell) const {
+        size_t length = std::min<size_t>(cell.size(), 63);
+        if (!(lengths >> length & 1)) {
+            return false;
+        }
+        return cell.empty() || std::find(tokens.begin(), tokens.end(), cell) != tokens.end();
+    }
+};
+
+/// Receives cells of a single column straight from the input buffer.
+class ColumnBuilder {
+  public:
+    virtual ~ColumnBuilder() = default;
+
+    /// Append a cell. The view is only valid during the call.
+    virtual void push(std::string_view cell) = 0;
+    /// Append a missing value, e.g. for a record that is shorter than the header.
+    virtual void push_na() = 0;
+    /// Number of accumulated values.
+    virtual size_t size() const = 0;
+    ///
+    virtual void reserve(size_t) = 0;
+    /// Move values of a builder of the same kind to the end of this one.
+    virtual void merge(ColumnBuilder& other) = 0;
+    /// Move accumulated values into a Series.
+    virtual std::unique_ptr<SeriesUntyped> finish() = 0;
+};
+
+/**
+ * Builds Series<std::string>, NA tokens become missing values and are never stored.
+ *
+ * Cells are dictionary encoded while there are few distinct ones, such columns become Categorical.
+ */
+class StringColumnBuilder : public ColumnBuilder {
+    StringArena cells;
+    Bitmap      valid;
+    NaTokens    na;
+    /// Most distinct cells to encode, encoding stops once there are more.
+    size_t                   max_categories;
+    std::vector<std::string> categories;
+    CodeMap                  codes_of;
+    AlignedVector<uint32_t>  codes;
+
+  public:
+    /// @param max_categories 0 never encodes.
+    StringColumnBuilder(NaTokens na = {}, size_t max_categories = 0);
+
+    void                           push(std::string_view cell) override;
+    void                           push_na() override;
+    size_t                         size() const override;
+    void                           reserve(size_t) override;
+    void                           merge(ColumnBuilder& other) override;
+    std::unique_ptr<SeriesUntyped> finish() override;
+
+  private:
+    bool encoding() const {
+        return max_categories > 0;
+    }
+    /// Stop encoding and keep cells as strings.
+    void decode();
+};
+
+/// Type of a loaded column.
+enum class ColumnType {
+    Int64,  ///< Series<int64_t>
+    Double, ///< Series<double>
+    String, ///< Series<std::string>
+};
+
+/// Narrowest column type that can hold the cell. Empty cells fit any type, spellings like `nan` or `inf` are text.
+ColumnType classify(std::string_view cell);
+
+/// Records the narrowest type that fits every cell of a column, values are not stored. NA tokens fit any type.
+class TypeScanBuilder : public ColumnBuilder {
+    ColumnType type_ = ColumnType::Int64;
+    size_t     cells = 0;
+    NaTokens   na;
+
+  public:
+    TypeScanBuilder(NaTokens na = {});
+
+    ColumnType type() const {
+        return type_;
+    }
+
+    void   push(std::string_view cell) override;
+    void   push_na() override;
+    size_t size() const override;
+    void   reserve(size_t) override;
+    void   merge(ColumnBuilder& other) override;
+    /// Always nullptr, only the type is of interest.
+    std::unique_ptr<SeriesUntyped> finish() override;
+};
+
+/**
+ * Builds Series<int64_t> or Series<double> straight from cells.
+ *
+ * Integers are promoted to doubles when a fractional cell shows up.
+ * A cell that is not a number marks the builder as failed, the column then has to be parsed as strings.
+ */
+class NumberColumnBuilder : public ColumnBuilder {
+    ColumnType             type_;
+    AlignedVector<int64_t> integers;
+    AlignedVector<double>  reals;
+    Bitmap                 valid;
+    bool                   failed_ = false;
+    NaTokens               na;
+    bool                   fixed;
+
+  public:
+    /**
+     * @param fixed The type is declared rather than guessed: integers are not promoted to doubles
+     *              and cells that do not parse throw std::invalid_argument instead of failing the column.
+     */
+    NumberColumnBuilder(ColumnType type = ColumnType::Int64, NaTokens na = {}, bool fixed = false);
+
+    bool failed() const {
+        return failed_;
+    }
+
+    void                           push(std::string_view cell) override;
+    void                           push_na() override;
+    size_t                         size() const override;
+    void                           reserve(size_t) override;
+    void                           merge(ColumnBuilder& other) override;
+    std::unique_ptr<SeriesUntyped> finish() override;
+
+  private:
+    void promote();
+};
+
+/// Creates an empty builder for the column with a given index.
+using BuilderFactory = std::function<std::unique_ptr<ColumnBuilder>(size_t)>;
+
+/// How column types are chosen while loading.
+enum class Inference {
+    None,   ///< Keep every column as strings.
+    Sample, ///< Guess from the first `sample_rows` records, columns that turn out not to fit are reparsed as strings.
+    Full,   ///< Scan the whole input for types before parsing.
+};
+
+/// Parameters of DataFrame::load.
+struct LoadOptions {
+    ///
+    Inference inference = Inference::Sample;
+    /// Number of records to look at with Inference::Sample.
+    size_t sample_rows = 1000;
+    /// Number of parsing threads, 0 for one per hardware thread.
+    size_t threads = 0;
+    /// Inputs are split into chunks of at least this many bytes.
+    size_t min_chunk_size = 1 << 20;
+    /// Names of columns to load, all columns when empty.
+    std::vector<std::string> columns;
+    /// Cells equal to one of these, e.g. `NA`, `null` or `?`, are missing values. Empty cells always are.
+    std::vector<std::string> na_tokens;
+    /// NA tokens of specific columns, used instead of na_tokens for them.
+    std::unordered_map<std::string, std::vector<std::string>> column_na_tokens;
+    /// Declared types of specific columns, they are neither inferred nor reparsed.
+    std::unordered_map<std::string, ColumnType> column_types;
+    /// Load only the first records, parsing stops after them.
+    std::optional<size_t> head;
+    /// Load only the last records, found by scanning backwards from the end.
+    std::optional<size_t> tail;
+    /// Keep every record with this probability if below 1, otherwise a uniform sample of this many records.
+    std::optional<double> sample;
+    /// Seed of sampling, random if not set.
+    std::optional<uint64_t> seed;
+    /// Only locate cells while loading, columns are parsed when first accessed. Columns with declared types are parsed
+    /// by load, so it throws on cells that do not fit them.
+    bool lazy = true;
+    /**
+     * Text columns with at most this many distinct values, each repeated twice on average, become Categorical.
+     * 0 keeps all text columns as Series<std::string>. Columns declared as strings are never encoded.
+     */
+    size_t max_categories = 256;
+
+    /// NA tokens of a column.
+    NaTokens na_for(const std::string& column) const;
+};
+
+/**
+ * Declare columns of the data in load options.
+ *
+ * A schema is itself a CSV with one record per column and the header `column,type[,na][,keep]`:
+ *  - `type` is `int64`, `double` or `string`,
+ *  - `na` lists the NA tokens of the column separated by spaces, the global ones are used when it is empty,
+ *  - `keep` set to `no` or `false` leaves the column out.
+ *
+ * Only columns of the schema are loaded, in its order.
+ */
+void parse_schema(std::string_view schema, LoadOptions& options);
+
+/// Read a schema file, see parse_schema.
+void read_schema(const std::string& filename, LoadOptions& options);
+
+/// Whether a path is a glob pattern like `data/*.csv`, a file that exists under the path is never a pattern.
+bool is_pattern(std::string_view path);
+
+/**
+ * Files matching a glob pattern, in sorted order.
+ *
+ * @throws std::runtime_error if no file matches.
+ */
+std::vector<std::string> expand_pattern(const std::string& pattern);
+
+/**
+ * Split the header line off the buffer.
+ *
+ * @param buffer Whole CSV content, advanced past the header on return.
+ *
+ * @returns Column names.
+ */
+std::vector<std::string> parse_header(std::string_view& buffer, char delimiter = ',');
+
+/// Thrown for a record that has more cells than the header.
+class MalformedRecord : public std::runtime_error {
+  public:
+    /// Index of the record in the tokenized body, from 0.
+    size_t record;
+
+    explicit MalformedRecord(size_t record);
+};
+
+/**
+ * Tokenize records of a CSV body and hand every cell to the builder of its column.
+ *
+ * Quoted cells follow RFC 4180: quotes are stripped and doubled quotes are unescaped.
+ * Empty lines are skipped if there are several builders, for a single one they are records with a missing cell.
+ * Missing trailing cells are reported as missing values.
+ *
+ * @param body CSV content without the header.
+ * @param builders One builder per column of the header.
+ * @param limit Stop after this many records.
+ *
+ * @returns Number of parsed records.
+ *
+ * @throws MalformedRecord if a record has more cells than there are builders.
+ */
+size_t parse_records(std::string_view body, std::span<ColumnBuilder* const> builders, char delimiter = ',',
+                     size_t limit = std::numeric_limits<size_t>::max());
+
+/**
+ * Split the first n records off a CSV body.
+ *
+ * Line breaks inside quoted cells do not end records, empty lines are skipped like parse_records does.
+ *
+ * @param body CSV content without the header, advanced past the taken records on return.
+ * @param width Number of columns, empty lines are records of a single column.
+ */
+std::string_view take_records(std::string_view& body, size_t n, size_t width, char delimiter = ',');
+
+/**
+ * The last n records of a CSV body.
+ *
+ * Records are split like take_records does, the body is scanned forwards since whether a line break is inside quotes
+ * depends on everything before it. Empty lines are records only if width is 1.
+ */
+std::string_view last_records(std::string_view body, size_t n, size_t width, char delimiter = ',');
+
+/**
+ * Narrow a CSV body down to the records requested by head, tail and sample of options, in this order.
+ *
+ * Sampling is a single pass: Bernoulli for a fraction, reservoir sampling for a number of records.
+ * Sampled records keep their order in the body.
+ *
+ * @param width Number of columns, see take_records.
+ * @param storage Holds sampled records, since they are not contiguous in the body.
+ *
+ * @returns The body itself when no reduction is requested.
+ */
+std::string_view reduce_records(std::string_view body, size_t width, const LoadOptions& options,
+                                std::string& storage, char delimiter = ',');
+
+/**
+ * Split a CSV body into at most `parts` chunks that start and end at record boundaries.
+ *
+ * Line breaks inside quoted cells are not boundaries. A quote opens a quoted cell only at the start of a cell, like
+ * the tokenizer reads it. Every equally sized slice is scanned in parallel for the state it ends in from each state
+ * it may start in, then the states are chained and each slice is advanced to its first line break outside quotes.
+ */
+std::vector<std::string_view> split_records(std::string_view body, size_t parts, size_t threads = 0,
+                                            char delimiter = ',');
+
+/**
+ * Parse chunks of a CSV body on worker threads and stitch per-chunk columns together.
+ *
+ * @param width Number of columns.
+ * @param factory Creates builders for every chunk.
+ * @param records Receives the number of parsed records.
+ *
+ * @returns One builder per column holding values of all chunks in order.
+ */
+std::vector<std::unique_ptr<ColumnBuilder>> parse_records_parallel(std::string_view body, size_t width,
+                                                                   const BuilderFactory& factory, size_t& records,
+                                                                   const LoadOptions& options = {},
+                                                                   char               delimiter = ',');
+
+/**
+ * Resolve column names to their indices in the header.
+ *
+ * @param columns Names to select, every column when empty.
+ *
+ * @returns Indices in the order of `columns`.
+ */
+std::vector<size_t> select_columns(const std::vector<std::string>& header, const std::vector<std::string>& columns);
+
+/**
+ * Infer types of the selected columns of a CSV body.
+ *
+ * @returns One type per column, String for the columns that are not selected and with Inference::None.
+ */
+std::vector<ColumnType> infer_types(std::string_view body, const std::vector<std::string>& header,
+                                    std::span<const size_t> selected, const LoadOptions& options = {},
+                                    char delimiter = ',');
+
+/**
+ * Parse the selected columns of a CSV body into typed columns.
+ *
+ * Numeric columns are parsed straight into Series<int64_t>/Series<double>, so no cell of them
+ * is ever stored as a string. Cells of columns that are not selected are skipped without allocation.
+ * NA tokens are matched while tokenizing and written as missing values.
+ *
+ * @param header Column names, used to look up NA tokens of columns.
+ * @param selected Indices of columns to build.
+ * @param records Receives the number of parsed records.
+ *
+ * @returns One Series per selected column, in the order of `selected`.
+ */
+std::vector<std::unique_ptr<SeriesUntyped>> read_columns(std::string_view body, const std::vector<std::string>& header,
+                                                         std::span<const size_t> selected, size_t& records,
+                                                         const LoadOptions& options = {}, char delimiter = ',');
+
+/// Hands out consecutive pieces of an input, an empty piece marks its end.
+using PieceSource = std::function<std::string_view()>;
+/// Starts an input from its beginning.
+using SourceFactory = std::function<PieceSource()>;
+
+/**
+ * Parse a CSV input that arrives in pieces, e.g. from a Decompressor.
+ *
+ * Complete records of a piece are tokenized as soon as it arrives, so producing the next piece
+ * overlaps with parsing. Types are guessed from the records of the first piece like with Inference::Sample.
+ * Parsed text is never kept: columns whose guessed numeric type fails are parsed again as strings from a second
+ * source of the input.
+ *
+ * @param open Called once, and once more if a guessed type fails.
+ * @param header Receives all column names.
+ * @param selected Receives indices of loaded columns, see select_columns.
+ * @param records Receives the number of parsed records.
+ *
+ * @returns One Series per selected column.
+ */
+std::vector<std::unique_ptr<SeriesUntyped>> read_pieces(const SourceFactory& open, std::vector<std::string>& header,
+                                                        std::vector<size_t>& selected, size_t& records,
+                                                        const LoadOptions& options = {}, char delimiter = ',');
+
+/**
+ * Positions of records and cells of a CSV body, found by a single structural pass.
+ *
+ * Columns are then built one at a time from their cells, without tokenizing the body again.
+ * Every cell costs 4 bytes: its end relative to the start of its record.
+ */
+class RecordIndex {
+    std::string_view      body;
+    size_t                width;
+    std::vector<uint64_t> rows;
+    std::vector<uint32_t> ends;
+
+  public:
+    /// End of a cell that a short record lacks.
+    static constexpr uint32_t missing = std::numeric_limits<uint32_t>::max();
+
+    /// @param width Number of columns.
+    RecordIndex(std::string_view body, size_t width, const LoadOptions& options = {}, char delimiter = ',');
+
+    /// Number of records.
+    size_t size() const {
+        return rows.size();
+    }
+
+    /// Text of a cell as it is in the body, quotes included. Nothing for a cell that a short record lacks.
+    std::optional<std::string_view> raw(size_t row, size_t column) const;
+    /**
+     * Content of a cell without quotes.
+     *
+     * @param scratch Backing storage for quoted cells that contain escaped quotes.
+     */
+    std::optional<std::string_view> cell(size_t row, size_t column, std::string& scratch) const;
+
+    /**
+     * Parse one column like read_columns would.
+     *
+     * @param name Column name, used to look up its NA tokens and declared type.
+     */
+    std::unique_ptr<SeriesUntyped> read_column(size_t column, const std::string& name,
+                                               const LoadOptions& options = {}) const;
+
+  private:
+    /// Push cells of rows [first, last) of a column.
+    void feed(size_t column, size_t first, size_t last, ColumnBuilder& builder) const;
+};
+
+} // namespace Luxora
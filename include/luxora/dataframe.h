@@ -1,14 +1,17 @@
 #pragma once
 
+#include "luxora/categorical.h"
+#include "luxora/csv.h"
 #include "luxora/series.h"
 #include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <ostream>
-#include <rapidcsv.h>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <typeindex>
 #include <typeinfo>
@@ -63,12 +66,19 @@ enum NormMethod {
  * For the sake of "dynamic typization" unique_ptr<SeriesUntyped> is used.
  */
 class DataFrame {
-    /// Stores series of different data types.
-    std::vector<std::unique_ptr<SeriesUntyped>> columns;
+    /// Cells of columns that were not parsed yet, see LoadOptions::lazy.
+    struct LazySource;
+
+    /// Stores series of different data types, nullptr for a column that is not parsed yet.
+    mutable std::vector<std::unique_ptr<SeriesUntyped>> columns;
+    /// Where columns that are not parsed yet come from, released once every column is parsed.
+    mutable std::shared_ptr<LazySource> source;
     /// A mapping between column name and its index in columns.
     std::unordered_map<std::string, size_t> column_indices;
     /// Vector of column names.
     std::vector<std::string> column_names;
+    /// Loaded from some of the columns of a file, appended files may then have more columns.
+    bool column_subset = false;
 
   public:
     /// Shape of the dataframe (height, width).
@@ -78,10 +88,31 @@ class DataFrame {
     DataFrame();
     DataFrame(std::string filename);
 
-    /// Load data frame from .csv file.
-    void load(std::string filename);
+    /**
+     * Load data frame from .csv file, .csv.gz and .csv.zst files are decompressed while parsing.
+     *
+     * A glob pattern like `data/day-??.csv` loads all matching files on parallel workers and concatenates them.
+     * Head, tail and sample then apply to every file. A path that names an existing file, like `data[1].csv`, is
+     * loaded as that file.
+     */
+    void load(std::string filename, const LoadOptions& options = {});
+    ///
+    void load(std::istream& is, const LoadOptions& options = {});
+    /**
+     * Add records of another file after the loaded ones.
+     *
+     * Only the new file is parsed, straight into the types of existing columns, and every Series grows in place.
+     * Columns of the file are matched by name. If the data frame was loaded from some of the columns of its file,
+     * other columns of the new file are skipped.
+     *
+     * Every column is parsed and checked before any of them grows, so the data frame stays as it was on failure.
+     *
+     * @throws std::invalid_argument if the file lacks a column of the data frame, has a column that the data frame
+     *                               does not have, or a column with an incompatible type.
+     */
+    void append(std::string filename, const LoadOptions& options = {});
     ///
-    void load(std::istream& is);
+    void append(std::istream& is, const LoadOptions& options = {});
     /// Save data frame to a new file.
     void save(std::string filename) const;
     ///
@@ -104,8 +135,12 @@ class DataFrame {
 
     template <class U>
     void convert_column(std::string column_name, std::string new_name = "") {
-        size_t          column_id = column_indices[column_name];
-        std::type_index ti        = columns[column_id]->type();
+        size_t          column_id = index_of(column_name);
+        std::type_index ti        = column(column_id).type();
+        if (ti == typeid(Categorical)) {
+            convert_categorical<U>(column_name, new_name);
+            return;
+        }
         // clang-format off
 		#define support1(type)                                                                                                 \
 			else if (ti == typeid(type)) {                                                                                     \
@@ -115,6 +150,7 @@ class DataFrame {
 		if constexpr (false) {} 
 			support1(int) 
 			support1(long long)
+			support1(int64_t)
 			support1(float)
 			support1(double)
 			support1(size_t)
@@ -128,35 +164,66 @@ class DataFrame {
     /// Impute missing values with a strategy.
     void fill_na(std::string column_name, Strategy strategy = Strategy::Mean);
 
-    ///
+    /**
+     * Address a column by position.
+     *
+     * A Categorical column accessed as std::string is decoded into Series<std::string> in its place.
+     *
+     * @throws std::invalid_argument if T is not the type of the column.
+     */
     template <typename T>
     Series<T>& column_at(size_t index) {
         return *get_column<T>(index);
     }
-    /// Address a column by name.
+    /**
+     * Address a column by name, see column_at(size_t).
+     *
+     * @throws std::invalid_argument if there is no such column or T is not its type.
+     */
     template <typename T>
     Series<T>& column_at(std::string column) {
         return *get_column<T>(column);
     }
+    /**
+     * Address a dictionary encoded column, see LoadOptions::max_categories.
+     *
+     * @throws std::invalid_argument if the column is not Categorical.
+     */
+    Categorical& categorical_at(std::string column);
+
+    /**
+     * Rows in which the column equals value as text, dictionary encoded columns compare codes only.
+     *
+     * @throws std::invalid_argument if there is no such column.
+     */
+    std::vector<size_t> rows_equal(std::string column_name, std::string_view value) const;
+    /**
+     * Number of rows of every distinct value of the column, in order of first occurrence.
+     *
+     * @throws std::invalid_argument if there is no such column.
+     */
+    std::vector<std::pair<std::string, size_t>> value_counts(std::string column_name) const;
 
     /**
      * Find outliers in the column.
      *
      * @param column_name A column to find outliers
+     * @param approx Take quartiles from a quantile sketch instead of selecting them exactly.
      *
      * @returns Vector of outliers.
      */
     template <class T>
-    std::vector<T> outliers(std::string column_name);
+    std::vector<T> outliers(std::string column_name, bool approx = false);
     /**
      * Find rows in which the column has outliers.
      *
      * @param column_name A column to find outliers
+     * @param approx Take quartiles from a quantile sketch instead of selecting them exactly.
      *
      * @returns Indices of rows with outliers.
      */
     template <class T>
-    std::vector<size_t> outlier_indices(std::string column_name);
+    std::vector<size_t> outlier_indices(std::string column_name, bool approx = false);
 
     friend std::ostream& operator<<(std::ostream& out, const DataFrame& df);
 
@@ -169,68 +236,112 @@ class DataFrame {
      */
     template <class T>
     void normalize(std::string column_name, std::string new_name = "", NormMethod method = MinMax);
+    /**
+     * Normalize series with statistics computed elsewhere, e.g. over a whole file.
+     *
+     * @param lower Subtracted from values: min for MinMax, mean for Zscore.
+     * @param scale Values are divided by it: range for MinMax, stddev for Zscore.
+     */
+    template <class T>
+    void normalize(std::string column_name, std::string new_name, T lower, T scale);
 
   private:
-    DataFrame(std::vector<std::string>, std::unordered_map<std::string, size_t>, const std::vector<SeriesUntyped>&);
+    friend class BatchReader;
+    friend class Stream;
 
-    void load_from_document(const rapidcsv::Document& document);
+    DataFrame(std::vector<std::string>, std::unordered_map<std::string, size_t>, const std::vector<SeriesUntyped>&);
 
-    std::ostream& write(std::ostream& os, std::string none) const;
+    /**
+     * Parse a whole CSV buffer, replacing current columns.
+     *
+     * @param input Owner of the buffer, columns are only parsed when accessed if it is given.
+     */
+    void load_from_buffer(std::string_view buffer, const LoadOptions& options, std::shared_ptr<const void> input = {});
+    /// Parse records that follow a known header, replacing current columns.
+    void load_records(const std::vector<std::string>& header, std::string_view body, const LoadOptions& options,
+                      std::shared_ptr<const void> input = {});
+    /// A column, parsed first if it was not yet.
+    SeriesUntyped& column(size_t column_id) const;
+    /**
+     * Parse files with the same header concurrently and join their columns, replacing current columns.
+     *
+     * @throws std::invalid_argument if headers of the files differ.
+     */
+    void load_files(const std::vector<std::string>& files, const LoadOptions& options);
+    /// Parse a compressed CSV file while it is being decompressed, replacing current columns.
+    void load_compressed(const std::string& filename, const LoadOptions& options);
+    /// Options that load columns of this data frame, in its order and with its types.
+    LoadOptions append_options(LoadOptions options) const;
+    /// Move rows of a data frame with the same columns after the current ones.
+    void append_rows(DataFrame&& tail);
+    /// Set names and shape after columns of the selected header fields were loaded.
+    void name_columns(const std::vector<std::string>& header, std::span<const size_t> selected);
+
+    /// Index of a column in columns, throws std::invalid_argument if there is no such column.
+    size_t index_of(const std::string& column_name) const;
+
+    std::ostream& write(std::ostream& os, std::string none, bool header = true) const;
+    /// Series to store a result of an operation on column_name, the column itself when new_name is empty.
+    template <class T>
+    Series<T>* target_column(std::string column_name, std::string new_name);
     template <class T>
     Series<T>* get_column(size_t column_id) const {
-        if (typeid(T) != columns[column_id]->type()) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            if (auto* categories = dynamic_cast<Categorical*>(&column(column_id))) {
+                columns[column_id] = std::make_unique<Series<std::string>>(categories->decode());
+            }
+        }
+        if (typeid(T) != column(column_id).type()) {
             throw std::invalid_argument("Supplied type differs from original");
         }
-        Series<T>* column = dynamic_cast<Series<T>*>(columns[column_id].get());
-        if (!column) {
+        Series<T>* series = dynamic_cast<Series<T>*>(columns[column_id].get());
+        if (!series) {
             throw std::bad_cast();
         }
-        return column;
+        return series;
     }
     template <class T>
     Series<T>* get_column(std::string column_name) const {
-        size_t column_id = column_indices.at(column_name);
-        return get_column<T>(column_id);
+        return get_column<T>(index_of(column_name));
     }
 
+    /// Store a converted column in place of column_name or in new_name.
+    template <class U>
+    void store_converted(Series<U>&& converted, std::string column_name, std::string new_name);
     template <class T, class U>
     void convert_column_with_conv(std::function<U(const T&)> conv, std::string column_name, std::string new_name = "");
     template <class T, class U>
     void convert_column_easy_conv(std::string column_name, std::string new_name = "");
+    /// Parse a string column into numbers in bulk, cells that are not numbers become missing values.
+    template <class U>
+    void convert_column_parsed(std::string column_name, std::string new_name = "");
     template <class T, class U>
     void convert_column_strictly_typed(std::string column_name, std::string new_name = "");
 
     template <class T>
     void fill_na_typed(std::string column_name, Strategy strategy = Strategy::Mean);
+    /// Convert categories once each, codes then pick converted values.
+    template <class U>
+    void convert_categorical(std::string column_name, std::string new_name);
 };
 
-template <class T, class U>
-void DataFrame::convert_column_with_conv(std::function<U(const T&)> conv, std::string column_name,
-                                         std::string new_name) {
-    size_t     column_id = column_indices[column_name];
-    Series<T>* series    = get_column<T>(column_id);
-    if (new_name == "" || column_name == new_name) {
-        Series<U> new_series = series->template map<U>(conv);
-        columns[column_id]   = std::make_unique<Series<U>>(new_series);
+template <class U>
+void DataFrame::convert_categorical(std::string column_name, std::string new_name) {
+    const Categorical& categories = categorical_at(column_name);
+    if constexpr (std::is_same_v<U, std::string>) {
+        store_converted(categories.decode(), column_name, new_name);
+    } else if constexpr (std::is_arithmetic_v<U>) {
+        store_converted(categories.template parse<U>(), column_name, new_name);
     } else {
-        size_t new_column;
-        if (column_indices.count(new_name)) {
-            new_column = column_indices[new_name];
-        } else {
-            new_column = add_column<U>(new_name);
-        }
-        Series<U>* new_series = get_column<U>(new_column);
-        *new_series           = series->template map<U>(conv);
+        throw std::invalid_argument("Conversion from `" + type_name(typeid(Categorical)) + "` to `" +
+                                    type_name(typeid(U)) + "` is not supported.");
     }
 }
 
-template <class T, class U>
-void DataFrame::convert_column_easy_conv(std::string column_name, std::string new_name) {
-    size_t     column_id = column_indices[column_name];
-    Series<T>* series    = get_column<T>(column_id);
+template <class U>
+void DataFrame::store_converted(Series<U>&& converted, std::string column_name, std::string new_name) {
     if (new_name == "" || column_name == new_name) {
-        Series<U> new_series = series->template cast<U>();
-        columns[column_id]   = std::make_unique<Series<U>>(new_series);
+        columns[column_indices[column_name]] = std::make_unique<Series<U>>(std::move(converted));
     } else {
         size_t new_column;
         if (column_indices.count(new_name)) {
@@ -238,11 +349,29 @@ void DataFrame::convert_column_easy_conv(std::string column_name, std::string ne
         } else {
             new_column = add_column<U>(new_name);
         }
-        Series<U>* new_series = get_column<U>(new_column);
-        *new_series           = series->template cast<U>();
+        *get_column<U>(new_column) = std::move(converted);
     }
 }
 
+template <class T, class U>
+void DataFrame::convert_column_with_conv(std::function<U(const T&)> conv, std::string column_name,
+                                         std::string new_name) {
+    Series<T>* series = get_column<T>(column_name);
+    store_converted(series->template map<U>(conv), column_name, new_name);
+}
+
+template <class T, class U>
+void DataFrame::convert_column_easy_conv(std::string column_name, std::string new_name) {
+    Series<T>* series = get_column<T>(column_name);
+    store_converted(series->template cast<U>(), column_name, new_name);
+}
+
+template <class U>
+void DataFrame::convert_column_parsed(std::string column_name, std::string new_name) {
+    Series<std::string>* series = get_column<std::string>(column_name);
+    store_converted(series->template parse<U>(), column_name, new_name);
+}
+
 template <class T, class U>
 void DataFrame::convert_column_strictly_typed(std::string column_name, std::string new_name) {
     if constexpr (std::is_same_v<T, U>) {
@@ -266,21 +395,9 @@ void DataFrame::convert_column_strictly_typed(std::string column_name, std::stri
 			elseif1(float)
 			elseif1(double)
 			elseif1(size_t)
-	} else if constexpr (std::is_same_v<T, std::string>) {
-		#define elseif2(type)                                                                                                  \
-			else if constexpr (std::is_same_v<U, type>) {                                                                      \
-				convert_column_with_conv<T, U>(string2##type, column_name, new_name);                                          \
-				return;                                                                                                        \
-			}
-		if constexpr (std::is_same_v<U, long long>) {
-			convert_column_with_conv<T, U>(string2int64_t, column_name, new_name);
-			return;
-		}
-			elseif2(int)
-			elseif2(int64_t)
-			elseif2(float)
-			elseif2(double)
-			elseif2(size_t)
+	} else if constexpr (std::is_same_v<T, std::string> && std::is_arithmetic_v<U>) {
+		convert_column_parsed<U>(column_name, new_name);
+		return;
         // clang-format on
     }
     throw std::invalid_argument("Conversion from `" + type_name(typeid(T)) + "` to `" + type_name(typeid(U)) +
@@ -302,20 +419,22 @@ void DataFrame::fill_na_typed(std::string column_name, Strategy strategy) {
 }
 
 template <class T>
-void DataFrame::normalize(std::string column_name, std::string new_name, NormMethod method) {
-    size_t    column_id = column_indices[column_name];
-    Series<T>*series    = get_column<T>(column_id), *new_series;
+Series<T>* DataFrame::target_column(std::string column_name, std::string new_name) {
     if (new_name == "") {
-        new_series = series;
+        return get_column<T>(column_name);
+    }
+    size_t new_column;
+    if (column_indices.count(new_name)) {
+        new_column = column_indices[new_name];
     } else {
-        size_t new_column;
-        if (column_indices.count(new_name)) {
-            new_column = column_indices[new_name];
-        } else {
-            new_column = add_column<T>(new_name);
-        }
-        new_series = get_column<T>(new_column);
+        new_column = add_column<T>(new_name);
     }
+    return get_column<T>(new_column);
+}
+
+template <class T>
+void DataFrame::normalize(std::string column_name, std::string new_name, NormMethod method) {
+    Series<T>*series = get_column<T>(column_name), *new_series = target_column<T>(column_name, new_name);
     switch (method) {
     case MinMax:
         *new_series = series->normalized_minmax();
@@ -327,15 +446,21 @@ void DataFrame::normalize(std::string column_name, std::string new_name, NormMet
 }
 
 template <class T>
-std::vector<T> DataFrame::outliers(std::string column_name) {
+void DataFrame::normalize(std::string column_name, std::string new_name, T lower, T scale) {
+    Series<T>*series = get_column<T>(column_name), *new_series = target_column<T>(column_name, new_name);
+    *new_series      = series->normalized(lower, scale);
+}
+
+template <class T>
+std::vector<T> DataFrame::outliers(std::string column_name, bool approx) {
     Series<T>* series = get_column<T>(column_name);
-    return series->outliers();
+    return series->outliers(approx);
 }
 
 template <class T>
-std::vector<size_t> DataFrame::outlier_indices(std::string column_name) {
+std::vector<size_t> DataFrame::outlier_indices(std::string column_name, bool approx) {
     Series<T>* series = get_column<T>(column_name);
-    return series->outlier_indices();
+    return series->outlier_indices(approx);
 }
 
 template <typename T>
@@ -1,4 +1,8 @@
 #pragma once
 
+#include "compression.h"
+#include "csv.h"
 #include "dataframe.h"
 #include "series.h"
+#include "statistics.h"
+#include "stream.h"
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Luxora {
+
+/// Number of worker threads to use when 0 is requested.
+inline size_t default_threads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * Run task(i) for every i in [0, n) on a pool of worker threads.
+ *
+ * Workers pull indices from a shared counter, so uneven tasks are balanced.
+ * The first exception thrown by a task is rethrown after all workers have joined.
+ *
+ * @param threads Maximum number of workers, 0 for one per hardware thread.
+ */
+template <class F>
+void parallel_for(size_t n, size_t threads, F&& task) {
+    if (threads == 0) {
+        threads = default_threads();
+    }
+    threads = std::min(threads, n);
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    std::exception_ptr  error;
+    std::mutex          error_mutex;
+    auto                worker = [&]() {
+        for (size_t i = next++; i < n; i = next++) {
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = n;
+            }
+        }
+    };
+
+    std::vector<std::jthread> pool;
+    pool.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    pool.clear();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace Luxora
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <charconv>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace Luxora {
+
+/**
+ * Parse a whole cell as a number.
+ *
+ * Uses std::from_chars, so it does not allocate, throw or depend on the locale.
+ * Surrounding spaces and a leading `+` are accepted.
+ *
+ * @returns Parsed value or nothing if the cell is not a number of type T.
+ */
+template <typename T>
+std::optional<T> parse_number(std::string_view cell) {
+    static_assert(std::is_arithmetic_v<T>, "Only numbers can be parsed");
+    while (!cell.empty() && (cell.front() == ' ' || cell.front() == '\t')) {
+        cell.remove_prefix(1);
+    }
+    while (!cell.empty() && (cell.back() == ' ' || cell.back() == '\t')) {
+        cell.remove_suffix(1);
+    }
+    if (cell.size() > 1 && cell.front() == '+' && cell[1] != '-') {
+        cell.remove_prefix(1);
+    }
+    T value;
+    auto [end, ec] = std::from_chars(cell.data(), cell.data() + cell.size(), value);
+    if (ec != std::errc() || end != cell.data() + cell.size() || cell.empty()) {
+        return {};
+    }
+    return value;
+}
+
+/// Like parse_number, but throws std::invalid_argument if the cell is not a number.
+template <typename T>
+T parse_number_or_throw(std::string_view cell) {
+    if (auto value = parse_number<T>(cell)) {
+        return *value;
+    }
+    throw std::invalid_argument("`" + std::string(cell) + "` is not a number");
+}
+
+} // namespace Luxora
@@ -1,16 +1,27 @@
 #pragma once
 
+#include "luxora/bitmap.h"
+#include "luxora/parse.h"
+#include "luxora/simd.h"
+#include "luxora/sketch.h"
+#include "luxora/statistics.h"
+#include "luxora/strings.h"
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <initializer_list>
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <ostream>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <typeindex>
 #include <utility>
@@ -23,11 +34,11 @@ const constexpr auto int64_t2string = [](const int64_t& x) { return std::to_stri
 const constexpr auto float2string   = [](const float& x) { return std::to_string(x); };
 const constexpr auto double2string  = [](const double& x) { return std::to_string(x); };
 const constexpr auto size_t2string  = [](const size_t& x) { return std::to_string(x); };
-const constexpr auto string2int     = [](const std::string& x) { return std::stoi(x); };
-const constexpr auto string2int64_t = [](const std::string& x) { return (int64_t)std::stol(x); };
-const constexpr auto string2float   = [](const std::string& x) { return std::stof(x); };
-const constexpr auto string2double  = [](const std::string& x) { return std::stod(x); };
-const constexpr auto string2size_t  = [](const std::string& x) { return (size_t)std::stoul(x); };
+const constexpr auto string2int     = [](const std::string& x) { return parse_number_or_throw<int>(x); };
+const constexpr auto string2int64_t = [](const std::string& x) { return parse_number_or_throw<int64_t>(x); };
+const constexpr auto string2float   = [](const std::string& x) { return parse_number_or_throw<float>(x); };
+const constexpr auto string2double  = [](const std::string& x) { return parse_number_or_throw<double>(x); };
+const constexpr auto string2size_t  = [](const std::string& x) { return parse_number_or_throw<size_t>(x); };
 
 class SeriesUntyped {
   public:
@@ -39,9 +50,59 @@ class SeriesUntyped {
     virtual size_t           type_size() const = 0;
 
     virtual std::optional<std::string> string_at(size_t) const = 0;
+    /// Write the value at index as text, none in place of a missing value.
+    virtual void write_at(std::ostream& os, size_t index, std::string_view none) const {
+        if (auto cell = string_at(index)) {
+            os << *cell;
+        } else {
+            os << none;
+        }
+    }
+
+    /**
+     * Move values of another Series after the last one.
+     *
+     * Series<int64_t> and Series<double> are converted to an arithmetic type of this Series,
+     * any Series is converted to Series<std::string> as text.
+     *
+     * @throws std::invalid_argument if types are not compatible.
+     */
+    virtual void append(SeriesUntyped&& tail) = 0;
+    /// Whether append takes values of a Series of this type.
+    virtual bool accepts(std::type_index type) const = 0;
+    /// Make room for n values in total, so appending up to them does not reallocate.
+    virtual void reserve(size_t n) = 0;
+};
+
+/// Buffer of values of Series<T>.
+template <typename T>
+struct ValueBuffer {
+    using type = AlignedVector<T>;
+};
+/// Strings share one arena instead of an allocation each.
+template <>
+struct ValueBuffer<std::string> {
+    using type = StringArena;
+};
+template <typename T>
+using Values = typename ValueBuffer<T>::type;
+
+/// Memory that order statistics like Series::quantile keep between calls.
+enum class OrderMode {
+    Cached, ///< Non missing values are copied once and stay partially ordered for later queries.
+    Lean,   ///< Every query selects in a temporary copy, nothing is kept.
 };
 
+/// Callable on a `const T&` whose result converts to U, e.g. a transform for Series::map.
+template <typename F, typename T, typename U>
+concept MapsTo = std::invocable<F&, const T&> && std::convertible_to<std::invoke_result_t<F&, const T&>, U>;
+
 /// A Series of values of the same type.
+///
+/// Values are stored contiguously in a 64-byte aligned buffer next to a bitmap of values that are present,
+/// missing values hold `T()` so kernels can run over all values without branching.
+/// Strings are stored back to back in a StringArena and read as std::string_view.
+///
 /// Supports EDA functions like:
 ///
 /// - `quantile(float q)`
@@ -51,17 +112,33 @@ template <typename T>
 class Series : public SeriesUntyped {
     using Element = std::optional<T>;
     using Storage = std::vector<Element>;
-    /// Storage for values of the Series.
-    Storage storage;
+    /// Values of the Series, missing ones hold `T()`.
+    Values<T> storage;
+    /// Set for values that are present.
+    Bitmap validity_;
 
     /// Cache sorted non missing values.
     std::vector<T> sorted;
     /// When `sorted` needs update.
     bool needs_update = true;
+    /// Ranks already selected in `sorted` while it needs update, everything before a rank is not greater.
+    std::vector<size_t> selected;
+
+    /// Statistics derived from values, computed on first use.
+    struct Cache {
+        std::optional<Aggregates<T>>  aggregates; ///< Exact sum, min and max, for Reducible types.
+        std::optional<Statistics>     statistics; ///<
+        std::optional<QuantileSketch> sketch;     ///< Built with the default k.
+    };
+    /// Filled by const queries, dropped when values change and merged with statistics of appended values.
+    mutable Cache cache;
 
   public:
     Series(const Storage&);
+    Series(Storage&&);
     Series(const std::initializer_list<Element>&);
+    /// Take values and their validity as they are, missing values have to hold `T()`.
+    Series(Values<T>&& values, Bitmap&& validity);
 
     static Series from_vector(const std::vector<T>&); ///<
     Storage       get_vector() const;                 ///<
@@ -71,7 +148,8 @@ class Series : public SeriesUntyped {
         if constexpr (!std::is_same_v<T, U>) {
             throw std::runtime_error("Different types");
         } else {
-            storage = other.storage;
+            storage   = other.storage;
+            validity_ = other.validity_;
         }
     }
 
@@ -80,11 +158,14 @@ class Series : public SeriesUntyped {
         if constexpr (!std::is_same_v<T, U>) {
             throw std::runtime_error("Different types");
         } else {
-            storage = std::move(other.storage);
+            storage   = std::move(other.storage);
+            validity_ = std::move(other.validity_);
         }
     }
 
+    /// Values may be changed through the pointer, so cached statistics are dropped.
     std::byte* data() override {
+        invalidate();
         return reinterpret_cast<std::byte*>(storage.data());
     }
     const std::byte* data() const override {
@@ -93,6 +174,22 @@ class Series : public SeriesUntyped {
     size_t size() const override {
         return storage.size();
     }
+    /// Values including missing ones.
+    const Values<T>& values() const {
+        return storage;
+    }
+    ///
+    const Bitmap& validity() const {
+        return validity_;
+    }
+    /// Whether the value at index is present.
+    bool valid(size_t index) const {
+        return validity_[index];
+    }
+    ///
+    Element at(size_t index) const {
+        return valid(index) ? Element(storage[index]) : Element();
+    }
     std::type_index type() const override {
         return typeid(T);
     }
@@ -100,118 +197,222 @@ class Series : public SeriesUntyped {
         return sizeof(T);
     }
 
+    void append(SeriesUntyped&& tail) override {
+        if (tail.type() == typeid(T)) {
+            append(static_cast<Series<T>&&>(tail));
+            return;
+        }
+        if constexpr (std::is_same_v<T, std::string>) {
+            // Other columns, e.g. dictionary encoded ones, join as text.
+            reserve(size() + tail.size());
+            for (size_t i = 0; i < tail.size(); ++i) {
+                std::optional<std::string> cell = tail.string_at(i);
+                validity_.push_back(cell.has_value());
+                storage.push_back(std::move(cell).value_or(T()));
+            }
+            invalidate();
+            return;
+        }
+        if constexpr (std::is_arithmetic_v<T>) {
+            if (tail.type() == typeid(int64_t)) {
+                append(static_cast<const Series<int64_t>&>(tail).template cast<T>());
+                return;
+            }
+            if (tail.type() == typeid(double)) {
+                append(static_cast<const Series<double>&>(tail).template cast<T>());
+                return;
+            }
+        }
+        throw std::invalid_argument("Appended values have an incompatible type");
+    }
+    bool accepts(std::type_index other) const override {
+        return other == typeid(T) || std::is_same_v<T, std::string> ||
+               (std::is_arithmetic_v<T> && (other == typeid(int64_t) || other == typeid(double)));
+    }
+    /// Grow storage in place, a valid sorted cache is merged with sorted values of tail instead of sorting again.
+    void append(Series<T>&& tail);
+    ///
+    void append(const Series<T>& tail) {
+        append(Series<T>(tail));
+    }
+    void reserve(size_t n) override {
+        storage.reserve(n);
+        validity_.reserve(n);
+    }
+
     std::optional<std::string> string_at(size_t index) const override {
-        if (!storage[index].has_value()) {
+        if (!valid(index)) {
             return {};
         }
         if constexpr (std::is_same_v<T, std::string>) {
-            return storage[index].value();
+            return std::string(storage[index]);
         } else {
-            return std::to_string(storage[index].value());
+            return std::to_string(storage[index]);
         }
     }
 
     bool operator==(const Series<T>& other) const {
-        return storage == other.storage;
+        return validity_ == other.validity_ && storage == other.storage;
     }
 
-    ///
-    template <typename U>
-    Series<U> map(std::function<U(const T&)> f) const {
-        std::vector<std::optional<U>> converted(storage.size());
-        for (size_t i = 0; i < storage.size(); ++i) {
-            if (storage[i].has_value()) {
-                converted[i] = f(storage[i].value());
-            } else {
-                converted[i] = {};
+    /// Apply f to present values, missing ones stay missing. Simple arithmetic f compile to vector loops.
+    template <typename U, typename F>
+        requires MapsTo<F, T, U>
+    Series<U> map(F&& f) const {
+        if constexpr (std::is_arithmetic_v<T> && std::is_arithmetic_v<U>) {
+            Values<U> converted(size());
+            transform(converted.data(), f);
+            return Series<U>(std::move(converted), Bitmap(validity_));
+        } else {
+            Values<U> converted;
+            converted.reserve(size());
+            for (size_t i = 0; i < size(); ++i) {
+                converted.push_back(valid(i) ? U(f(value(i))) : U());
             }
+            return Series<U>(std::move(converted), Bitmap(validity_));
         }
-        return Series<U>(converted);
+    }
+    /// Type erased map, for conversions chosen at run time.
+    template <typename U>
+    Series<U> map(std::function<U(const T&)> f) const {
+        return map<U, decltype(f)&>(f);
     }
 
+    /// Apply f to every value, missing ones included, none makes the result missing.
+    template <typename U, typename F>
+        requires MapsTo<F, Element, std::optional<U>>
+    Series<U> map_option(F&& f) const {
+        Values<U> converted;
+        Bitmap    validity;
+        converted.reserve(size());
+        validity.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            std::optional<U> x = f(at(i));
+            validity.push_back(x.has_value());
+            converted.push_back(std::move(x).value_or(U()));
+        }
+        return Series<U>(std::move(converted), std::move(validity));
+    }
     ///
     template <typename U>
     Series<U> map_option(std::function<std::optional<U>(const Element&)> f) const {
-        std::vector<std::optional<U>> converted(storage.size());
-        for (size_t i = 0; i < storage.size(); ++i) {
-            converted[i] = f(storage[i]);
-        }
-        return Series<U>(converted);
+        return map_option<U, decltype(f)&>(f);
     }
 
+    ///
+    template <typename F>
+        requires MapsTo<F, T, T>
+    Series<T> map(F&& f) const {
+        return map<T>(std::forward<F>(f));
+    }
     ///
     Series<T> map(std::function<T(const T&)> f) const {
-        std::vector<std::optional<T>> converted(storage.size());
-        for (size_t i = 0; i < storage.size(); ++i) {
-            if (storage[i].has_value()) {
-                converted[i] = f(storage[i].value());
-            } else {
-                converted[i] = {};
-            }
-        }
-        return Series<T>(converted);
+        return map<T, decltype(f)&>(f);
     }
 
+    /// Replace present values with f of them, arithmetic values in place without branches.
+    template <typename F>
+        requires MapsTo<F, T, T>
+    void map_inplace(F&& f) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            transform(storage.data(), f);
+            invalidate();
+        } else {
+            update([&](size_t i) { return valid(i) ? Element(f(value(i))) : Element(); });
+        }
+    }
     ///
     void map_inplace(std::function<T(const T&)> f) {
-        for (size_t i = 0; i < storage.size(); ++i) {
-            if (storage[i].has_value()) {
-                storage[i] = f(storage[i].value());
-            } else {
-                storage[i] = {};
-            }
-        }
-        needs_update = true;
+        map_inplace<decltype(f)&>(f);
     }
 
     ///
-    void map_inplace_option(std::function<std::optional<T>(const std::optional<T>&)> f) const {
-        for (size_t i = 0; i < storage.size(); ++i) {
-            storage[i] = f(storage[i]);
-        }
+    template <typename F>
+        requires MapsTo<F, Element, Element>
+    void map_inplace_option(F&& f) {
+        update([&](size_t i) { return f(at(i)); });
+    }
+    ///
+    void map_inplace_option(std::function<std::optional<T>(const std::optional<T>&)> f) {
+        map_inplace_option<decltype(f)&>(f);
     }
 
     /// Cast a Series to a convertible type.
     template <typename U>
     Series<U> cast() const {
         if constexpr (std::is_convertible_v<T, U>) {
-            std::vector<std::optional<U>> converted(storage.size());
-            for (size_t i = 0; i < storage.size(); ++i) {
-                if (storage[i].has_value()) {
-                    converted[i] = static_cast<U>(storage[i].value());
-                } else {
-                    converted[i] = {};
-                }
-            }
-            return Series<U>(converted);
+            return map<U>([](const T& x) { return static_cast<U>(x); });
         } else {
             throw std::invalid_argument("Incompatible type for easy conversion");
         }
     }
 
-    T sum() const;    ///<
-    T mean() const;   ///<
-    T median() const; ///<
+    /**
+     * Parse strings into numbers in bulk.
+     *
+     * Cells that are not numbers become missing values instead of aborting the conversion.
+     */
+    template <typename U>
+    Series<U> parse() const {
+        static_assert(std::is_same_v<T, std::string>, "Only strings can be parsed");
+        Values<U> converted;
+        Bitmap    validity;
+        converted.reserve(size());
+        validity.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            std::optional<U> x = valid(i) ? parse_number<U>(storage[i]) : std::nullopt;
+            validity.push_back(x.has_value());
+            converted.push_back(x.value_or(U()));
+        }
+        return Series<U>(std::move(converted), std::move(validity));
+    }
+
+    /// Integers are summed as doubles, throws std::overflow_error if the sum does not fit T.
+    T sum() const;
+    T mean() const; ///<
+    /// Selects the middle values in a temporary copy, unless sorted values are cached.
+    T median() const;
 
     T max() const;   ///<
     T min() const;   ///<
     T range() const; ///< Computes max() - min()
 
-    /// Computes value that is greater than q fraction of values. Sorts data in the process.
-    T quantile(float q);
-    T iqr(); ///< A value of missing values, for example -1, "".
+    /**
+     * Computes value that is greater than q fraction of values.
+     *
+     * The value is selected in linear time. In OrderMode::Cached values that earlier queries partitioned stay
+     * partitioned, so a query only reorders the range between ranks selected before; after many queries
+     * the values are sorted once and later queries are lookups.
+     */
+    T quantile(float q, OrderMode mode = OrderMode::Cached);
+    /**
+     * Computes quantile(q) for every q of qs at once.
+     *
+     * Ranks are selected middle first, so each selection only partitions the range between two ranks selected
+     * before it: k quantiles cost O(n log k) instead of k passes over all values.
+     */
+    std::vector<T> quantiles(std::span<const float> qs, OrderMode mode = OrderMode::Cached);
+    T              iqr(); ///< Computes quantile(0.75) - quantile(0.25) in one selection.
+    /// Approximate quantiles in bounded memory, mergeable with sketches of other parts of the column.
+    QuantileSketch sketch(size_t k = QuantileSketch::default_k) const;
 
-    T variance() const; ///<
-    T stddev() const;   ///<
+    /// Throws std::overflow_error if the variance of integers does not fit T, describe() has it as a double.
+    T variance() const;
+    T stddev() const; ///<
 
     /// Counts non missing values.
     size_t count() const;
+    /// Count, null count, sum, mean, min, max and spread of the values in one pass, kept until values change.
+    Statistics describe() const;
 
     Series<T> normalized_minmax() const; ///<
     Series<T> normalized_zscore() const; ///<
+    /// Computes (x - lower) / scale for every value, e.g. with statistics of a whole file.
+    Series<T> normalized(T lower, T scale) const;
 
-    std::vector<T>      outliers();        ///<
-    std::vector<size_t> outlier_indices(); ///<
+    /// Values more than 1.5 IQR away from the quartiles, approx takes quartiles from sketch().
+    std::vector<T>      outliers(bool approx = false);
+    std::vector<size_t> outlier_indices(bool approx = false); ///< Indices of outliers().
 
     /**
      * Mark values that match na as missing.
@@ -230,28 +431,164 @@ class Series : public SeriesUntyped {
     friend std::ostream& operator<<(std::ostream&, const Series<T2>&);
 
   private:
+    /// Queries that select before values are sorted.
+    static constexpr size_t sort_after = 16;
+
     void           sort();
-    std::vector<T> filter();
+    std::vector<T> filter() const;
+    /// Value of the given rank among non missing values, see quantile.
+    T select(size_t rank);
+    /// Rank of every quantile among non missing values, throws if there are none.
+    std::vector<size_t> ranks_of(std::span<const float> qs) const;
+    /// Values of ranks, selected in `sorted` which keeps their order for later queries.
+    std::vector<T> select_cached(std::span<const size_t> ranks);
+    /// Values of ranks, selected in a temporary copy.
+    std::vector<T> select_lean(std::span<const size_t> ranks) const;
+    /// Call select for the middle of ranks first, then for both halves.
+    void select_middle_first(std::span<const size_t> ranks);
+    /// Partition values starting at rank `first` so that every rank of ranks holds its value, ranks are sorted.
+    static void select_ranks(std::span<T> values, size_t first, std::span<const size_t> ranks);
+    /// Drop cached order and statistics, values have changed.
+    void invalidate() {
+        needs_update = true;
+        selected.clear();
+        cache = {};
+    }
+
+    /// Sum or variance of a column as T, throws std::overflow_error if it does not fit.
+    static T narrow(SumType<T> x)
+        requires Reducible<T>
+    {
+        if constexpr (std::is_integral_v<T>) {
+            // The upper bound is rounded up to a power of two, so it is excluded.
+            if (!(x >= double(std::numeric_limits<T>::lowest()) && x < double(std::numeric_limits<T>::max()) + 1.0)) {
+                throw std::overflow_error("Result does not fit the type of the column");
+            }
+        }
+        return T(x);
+    }
+    /// Aggregates of all values, computed together with describe().
+    const Aggregates<T>& aggregates() const
+        requires Reducible<T>
+    {
+        if (!cache.aggregates) {
+            describe();
+        }
+        return *cache.aggregates;
+    }
+    /// Aggregates of present values, throws if there are none.
+    const Aggregates<T>& present() const
+        requires Reducible<T>
+    {
+        const Aggregates<T>& res = aggregates();
+        if (res.count == 0) {
+            throw std::logic_error("Not enough non missing values");
+        }
+        return res;
+    }
+    /// Value at index, a copy for strings.
+    decltype(auto) value(size_t index) const {
+        if constexpr (std::is_same_v<T, std::string>) {
+            return T(storage[index]);
+        } else {
+            return storage[index];
+        }
+    }
+    /// Replace the value at every index with f(index), none makes it missing.
+    template <typename F>
+    void update(F&& f);
+    /**
+     * Write f of every present value to out and U() for missing ones, out may be the values themselves.
+     *
+     * Blocks of 64 present values are transformed without branches, others test the validity of every value.
+     */
+    template <typename U, typename F>
+    void transform(U* out, F& f) const;
 };
 
 template <typename T>
-Series<T>::Series(const Storage& storage) : storage(storage) {}
+Series<T>::Series(const Storage& elements) {
+    storage.reserve(elements.size());
+    validity_.reserve(elements.size());
+    for (const Element& x : elements) {
+        storage.push_back(x.value_or(T()));
+        validity_.push_back(x.has_value());
+    }
+}
+
+template <typename T>
+Series<T>::Series(Storage&& elements) {
+    storage.reserve(elements.size());
+    validity_.reserve(elements.size());
+    for (Element& x : elements) {
+        validity_.push_back(x.has_value());
+        storage.push_back(std::move(x).value_or(T()));
+    }
+}
+
+template <typename T>
+Series<T>::Series(const std::initializer_list<Element>& init) : Series(Storage(init)) {}
 
 template <typename T>
-Series<T>::Series(const std::initializer_list<Element>& init) : storage(init) {}
+Series<T>::Series(Values<T>&& values, Bitmap&& validity)
+    : storage(std::move(values)), validity_(std::move(validity)) {
+    if (storage.size() != validity_.size()) {
+        throw std::invalid_argument("Values and validity differ in size");
+    }
+}
+
+template <typename T>
+void Series<T>::append(Series<T>&& tail) {
+    if (!needs_update) {
+        if (tail.needs_update) {
+            tail.sort();
+        }
+        size_t middle = sorted.size();
+        sorted.insert(sorted.end(), tail.sorted.begin(), tail.sorted.end());
+        std::inplace_merge(sorted.begin(), sorted.begin() + middle, sorted.end());
+    } else {
+        // Partially ordered values miss the tail.
+        selected.clear();
+    }
+    if constexpr (std::is_arithmetic_v<T>) {
+        // Cached statistics absorb those of the tail instead of being computed again.
+        if (cache.statistics) {
+            Statistics statistics = tail.describe();
+            cache.statistics->merge(statistics);
+            if constexpr (Reducible<T>) {
+                cache.aggregates->merge(*tail.cache.aggregates);
+            }
+        }
+        if (cache.sketch) {
+            cache.sketch->merge(tail.sketch());
+        }
+    }
+    if constexpr (std::is_same_v<T, std::string>) {
+        storage.append(tail.storage);
+    } else {
+        storage.insert(storage.end(), std::make_move_iterator(tail.storage.begin()),
+                       std::make_move_iterator(tail.storage.end()));
+    }
+    validity_.append(tail.validity_);
+}
 
 template <typename T>
 Series<T> Series<T>::from_vector(const std::vector<T>& vec) {
-    Storage storage(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i) {
-        storage[i] = std::make_optional(vec[i]);
+    Values<T> values;
+    values.reserve(vec.size());
+    for (const T& x : vec) {
+        values.push_back(x);
     }
-    return Series(storage);
+    return Series(std::move(values), Bitmap(vec.size(), true));
 }
 
 template <typename T>
 std::vector<std::optional<T>> Series<T>::get_vector() const {
-    return storage;
+    Storage elements(storage.size());
+    for (size_t i = 0; i < storage.size(); ++i) {
+        elements[i] = at(i);
+    }
+    return elements;
 }
 
 template <typename T>
@@ -261,7 +598,11 @@ T Series<T>::mean() const {
         if (c == 0) {
             throw std::logic_error("Not enough non missing values");
         }
-        return sum() / count();
+        if constexpr (Reducible<T>) {
+            // Integers are averaged from their sum as a double, which may not fit in T.
+            return T(aggregates().sum / c);
+        }
+        return sum() / c;
     } else {
         throw std::logic_error("Type is not arithmetic");
     }
@@ -269,10 +610,13 @@ T Series<T>::mean() const {
 
 template <typename T>
 T Series<T>::sum() const {
-    if constexpr (std::is_arithmetic_v<T>) {
+    if constexpr (Reducible<T>) {
+        return narrow(aggregates().sum);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        // Missing values hold 0.
         T sum = 0;
-        for (const std::optional<T>& x : storage) {
-            sum += x.value_or(0);
+        for (const T& x : storage) {
+            sum += x;
         }
         return sum;
     } else {
@@ -287,19 +631,11 @@ T Series<T>::median() const {
         throw std::logic_error("Not enough non missing values ");
     }
     if constexpr (std::is_arithmetic_v<T>) {
-        std::vector<T> buf(c);
-        int            i = 0;
-        for (const std::optional<T>& x : storage) {
-            if (x.has_value()) {
-                buf[i++] = x.value();
-            }
-        }
-        std::sort(buf.rbegin(), buf.rend());
-        if (buf.size() % 2 == 1) {
-            return buf[buf.size() / 2];
-        } else {
-            return (buf[buf.size() / 2 - 1] + buf[buf.size() / 2]) / 2;
+        if (c % 2 == 1) {
+            return select_lean(std::array{c / 2})[0];
         }
+        std::vector<T> middle = select_lean(std::array{c / 2 - 1, c / 2});
+        return (middle[0] + middle[1]) / 2;
     } else {
         throw std::logic_error("Type is not arithmetic");
     }
@@ -307,15 +643,18 @@ T Series<T>::median() const {
 
 template <typename T>
 T Series<T>::max() const {
+    if constexpr (Reducible<T>) {
+        return present().max;
+    }
     // TODO comparable
     size_t i = 0;
-    while (!storage[i].has_value()) {
+    while (!valid(i)) {
         i += 1;
     }
-    T res = storage[i].value();
+    T res(storage[i]);
     for (; i < size(); ++i) {
-        if (storage[i].has_value() && res < storage[i].value()) {
-            res = storage[i].value();
+        if (valid(i) && res < storage[i]) {
+            res = storage[i];
         }
     }
     return res;
@@ -323,14 +662,17 @@ T Series<T>::max() const {
 
 template <typename T>
 T Series<T>::min() const {
+    if constexpr (Reducible<T>) {
+        return present().min;
+    }
     size_t i = 0;
-    while (!storage[i].has_value()) {
+    while (!valid(i)) {
         i += 1;
     }
-    T res = storage[i].value();
+    T res(storage[i]);
     for (; i < size(); ++i) {
-        if (storage[i].has_value() && res > storage[i].value()) {
-            res = storage[i].value();
+        if (valid(i) && res > storage[i]) {
+            res = storage[i];
         }
     }
     return res;
@@ -338,38 +680,123 @@ T Series<T>::min() const {
 
 template <typename T>
 T Series<T>::range() const {
+    if constexpr (Reducible<T>) {
+        Aggregates<T> res = present();
+        return res.max - res.min;
+    }
     return max() - min();
 }
 
 template <typename T>
 size_t Series<T>::count() const {
-    size_t len = 0;
-    for (const std::optional<T>& x : storage) {
-        len += x.has_value();
+    return cache.statistics ? cache.statistics->count : validity_.count();
+}
+
+template <typename T>
+QuantileSketch Series<T>::sketch(size_t k) const {
+    if constexpr (std::is_arithmetic_v<T>) {
+        if (k == QuantileSketch::default_k && cache.sketch) {
+            return *cache.sketch;
+        }
+        QuantileSketch res(k);
+        for (size_t i = 0; i < size(); ++i) {
+            if (valid(i)) {
+                res.add(storage[i]);
+            }
+        }
+        if (k == QuantileSketch::default_k) {
+            cache.sketch = res;
+        }
+        return res;
+    } else {
+        throw std::logic_error("Type is not arithmetic");
     }
-    return len;
 }
 
 template <typename T>
-T Series<T>::quantile(float q) {
-    sort();
-    size_t index = q * count();
-    return sorted[index];
+Statistics Series<T>::describe() const {
+    if (cache.statistics) {
+        return *cache.statistics;
+    }
+    if constexpr (Reducible<T>) {
+        // Blocks stay in cache between their reduction and their squared deviations, so values are read from
+        // memory once. Blocks are merged like batches of a stream.
+        constexpr size_t block = 2048;
+        Statistics       res;
+        Aggregates<T>    total;
+        for (size_t from = 0; from < size(); from += block) {
+            size_t          n    = std::min(block, size() - from);
+            const T*        x    = storage.data() + from;
+            const uint64_t* bits = validity_.data() + from / 64;
+            Aggregates<T>   part = aggregate(x, bits, n);
+            Statistics      stats;
+            total.merge(part);
+            stats.null_count = n - part.count;
+            if (part.count > 0) {
+                stats.count = part.count;
+                stats.sum   = part.sum;
+                stats.mean  = stats.sum / stats.count;
+                stats.min   = part.min;
+                stats.max   = part.max;
+                // Deviations are taken from the mean rounded to SumType<T>, its distance to the exact mean is
+                // subtracted. Integers are centered on the exact mean. Rounding of floats may leave the
+                // difference slightly below 0.
+                SumType<T> center     = SumType<T>(stats.mean);
+                double     shift      = stats.mean - center;
+                double     deviations = squared_deviations(x, bits, n, center);
+                stats.m2              = deviations - stats.count * shift * shift;
+                if constexpr (std::is_floating_point_v<T>) {
+                    stats.m2 = std::max(0.0, stats.m2);
+                }
+            }
+            res.merge(stats);
+        }
+        cache.aggregates = total;
+        cache.statistics = res;
+        return res;
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        Statistics res;
+        for (size_t i = 0; i < size(); ++i) {
+            if (valid(i)) {
+                res.add(storage[i]);
+            } else {
+                ++res.null_count;
+            }
+        }
+        cache.statistics = res;
+        return res;
+    } else {
+        throw std::logic_error("Type is not arithmetic");
+    }
+}
+
+template <typename T>
+T Series<T>::quantile(float q, OrderMode mode) {
+    return quantiles(std::span(&q, 1), mode)[0];
+}
+
+template <typename T>
+std::vector<T> Series<T>::quantiles(std::span<const float> qs, OrderMode mode) {
+    std::vector<size_t> ranks = ranks_of(qs);
+    return mode == OrderMode::Cached ? select_cached(ranks) : select_lean(ranks);
 }
 
 template <typename T>
 T Series<T>::iqr() {
-    return quantile(0.75) - quantile(0.25);
+    std::vector<T> quartiles = quantiles(std::array{0.25f, 0.75f});
+    return quartiles[1] - quartiles[0];
 }
 
 template <typename T>
 T Series<T>::variance() const {
-    if constexpr (std::is_arithmetic_v<T>) {
+    if constexpr (Reducible<T>) {
+        return narrow(describe().variance());
+    } else if constexpr (std::is_arithmetic_v<T>) {
         T mean_ = mean();
         T res   = 0;
-        for (const std::optional<T>& x : storage) {
-            if (x.has_value()) {
-                res += (x.value() - mean_) * (x.value() - mean_);
+        for (size_t i = 0; i < size(); ++i) {
+            if (valid(i)) {
+                res += (storage[i] - mean_) * (storage[i] - mean_);
             }
         }
         return res / count();
@@ -380,15 +807,20 @@ T Series<T>::variance() const {
 
 template <typename T>
 T Series<T>::stddev() const {
+    if constexpr (Reducible<T>) {
+        return T(std::sqrt(describe().variance()));
+    }
     return std::sqrt(variance());
 }
 
 template <typename T>
 Series<T> Series<T>::normalized_minmax() const {
-    if constexpr (std::is_arithmetic_v<T>) {
+    if constexpr (Reducible<T>) {
+        Aggregates<T> res = present();
+        return normalized(res.min, res.max - res.min);
+    } else if constexpr (std::is_arithmetic_v<T>) {
         T min_ = min(), max_ = max();
-        T range_ = max_ - min_;
-        return map<T>([min_, max_, range_](const T& x) { return (x - min_) / range_; });
+        return normalized(min_, max_ - min_);
     } else {
         throw std::logic_error("Type is not arithmetic");
     }
@@ -397,24 +829,41 @@ Series<T> Series<T>::normalized_minmax() const {
 template <typename T>
 Series<T> Series<T>::normalized_zscore() const {
     if constexpr (std::is_arithmetic_v<T>) {
-        T mean_ = mean(), stddev_ = stddev();
-        return map<T>([mean_, stddev_](const T& x) { return (x - mean_) / stddev_; });
+        Statistics stats = describe();
+        return normalized(T(stats.mean), T(stats.stddev()));
+    } else {
+        throw std::logic_error("Type is not arithmetic");
+    }
+}
+
+template <typename T>
+Series<T> Series<T>::normalized(T lower, T scale) const {
+    if constexpr (std::is_arithmetic_v<T>) {
+        return map<T>([lower, scale](const T& x) { return (x - lower) / scale; });
     } else {
         throw std::logic_error("Type is not arithmetic");
     }
 }
 
 template <typename T>
-std::vector<size_t> Series<T>::outlier_indices() {
-    T                   q1 = quantile(0.25), q3 = quantile(0.75);
-    T                   iqr_        = iqr();
+std::vector<size_t> Series<T>::outlier_indices(bool approx) {
+    std::vector<T> quartiles;
+    if (approx) {
+        for (double q : sketch().quantiles(std::array{0.25f, 0.75f})) {
+            quartiles.push_back(q);
+        }
+    } else {
+        quartiles = quantiles(std::array{0.25f, 0.75f});
+    }
+    T                   q1 = quartiles[0], q3 = quartiles[1];
+    T                   iqr_        = q3 - q1;
     T                   upper_bound = q3 + 1.5f * iqr_, lower_bound = q1 - 1.5f * iqr_;
     std::vector<size_t> res;
     for (size_t i = 0; i < size(); ++i) {
-        if (!storage[i].has_value()) {
+        if (!valid(i)) {
             continue;
         }
-        if (storage[i].value() > upper_bound || storage[i].value() < lower_bound) {
+        if (storage[i] > upper_bound || storage[i] < lower_bound) {
             res.push_back(i);
         }
     }
@@ -422,41 +871,48 @@ std::vector<size_t> Series<T>::outlier_indices() {
 }
 
 template <typename T>
-std::vector<T> Series<T>::outliers() {
-    auto           indices = outlier_indices();
+std::vector<T> Series<T>::outliers(bool approx) {
+    auto           indices = outlier_indices(approx);
     std::vector<T> res(indices.size());
     for (size_t i = 0; i < res.size(); ++i) {
-        res[i] = storage[indices[i]].value();
+        res[i] = storage[indices[i]];
     }
     return res;
 }
 
 template <typename T>
 void Series<T>::identify_na(const T& na) {
-    for (std::optional<T>& x : storage) {
-        if (x.has_value() && x.value() == na) {
-            x = {};
-        }
-    }
-    needs_update = true;
+    update([&](size_t i) { return valid(i) && storage[i] == na ? Element() : at(i); });
 }
 
 template <typename T>
 void Series<T>::fill_na(const T& fill) {
-    for (std::optional<T>& x : storage) {
-        if (!x.has_value()) {
-            x = fill;
+    Cache kept = std::move(cache);
+    update([&](size_t i) { return valid(i) ? at(i) : Element(fill); });
+    if constexpr (std::is_arithmetic_v<T>) {
+        // Filled values add a constant block, known statistics take it without another scan.
+        if (kept.statistics) {
+            size_t     n = kept.statistics->null_count;
+            Statistics filled{n, 0, double(fill) * n, double(fill), 0, double(fill), double(fill)};
+            kept.statistics->null_count = 0;
+            kept.statistics->merge(filled);
+            if constexpr (Reducible<T>) {
+                if (n > 0) {
+                    kept.aggregates->merge({n, SumType<T>(fill) * n, fill, fill});
+                }
+            }
+            cache.statistics = kept.statistics;
+            cache.aggregates = kept.aggregates;
         }
     }
-    needs_update = true;
 }
 
 template <typename T2>
 std::ostream& operator<<(std::ostream& os, const Series<T2>& series) {
     os << std::string("Storage: ");
     for (size_t i = 0; i < series.size(); ++i) {
-        if (series.storage[i].has_value()) {
-            os << series.storage[i].value() << (i + 1 == series.size() ? "" : ", ");
+        if (series.valid(i)) {
+            os << series.storage[i] << (i + 1 == series.size() ? "" : ", ");
         } else {
             os << std::string("`None`") << (i + 1 == series.size() ? "" : ", ");
         }
@@ -469,22 +925,159 @@ std::ostream& operator<<(std::ostream& os, const Series<T2>& series) {
     return os;
 }
 
+template <typename T>
+template <typename F>
+void Series<T>::update(F&& f) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        // Strings change length, so they go to a new arena.
+        Values<T> updated;
+        updated.reserve(size(), storage.length());
+        for (size_t i = 0; i < size(); ++i) {
+            Element x = f(i);
+            validity_.set(i, x.has_value());
+            updated.push_back(x.value_or(T()));
+        }
+        storage = std::move(updated);
+    } else {
+        for (size_t i = 0; i < size(); ++i) {
+            Element x = f(i);
+            validity_.set(i, x.has_value());
+            storage[i] = x.value_or(T());
+        }
+    }
+    invalidate();
+}
+
+template <typename T>
+template <typename U, typename F>
+void Series<T>::transform(U* out, F& f) const {
+    const T* x = storage.data();
+    for (size_t from = 0; from < size(); from += 64) {
+        size_t   n    = std::min<size_t>(64, size() - from);
+        uint64_t word = validity_.word(from / 64);
+        if (n == 64 && word == ~uint64_t(0)) {
+            for (size_t i = from; i < from + 64; ++i) {
+                out[i] = U(f(x[i]));
+            }
+        } else {
+            for (size_t i = from; i < from + n; ++i) {
+                out[i] = word >> (i - from) & 1 ? U(f(x[i])) : U();
+            }
+        }
+    }
+}
+
 template <typename T>
 void Series<T>::sort() {
     if (needs_update) {
-        sorted = filter();
+        if (selected.empty()) {
+            sorted = filter();
+        }
         std::sort(sorted.begin(), sorted.end());
         needs_update = false;
+        selected.clear();
+    }
+}
+
+template <typename T>
+T Series<T>::select(size_t rank) {
+    if (needs_update && selected.size() >= sort_after) {
+        sort();
+    }
+    if (!needs_update) {
+        return sorted[rank];
+    }
+    if (selected.empty()) {
+        sorted = filter();
+    }
+    // Selected ranks split values into ranges ordered among each other, only the range holding rank is partitioned.
+    auto upper = std::lower_bound(selected.begin(), selected.end(), rank);
+    if (upper != selected.end() && *upper == rank) {
+        return sorted[rank];
+    }
+    size_t from = upper == selected.begin() ? 0 : *(upper - 1) + 1;
+    size_t to   = upper == selected.end() ? sorted.size() : *upper;
+    std::nth_element(sorted.begin() + from, sorted.begin() + rank, sorted.begin() + to);
+    selected.insert(upper, rank);
+    return sorted[rank];
+}
+
+template <typename T>
+std::vector<size_t> Series<T>::ranks_of(std::span<const float> qs) const {
+    size_t c = count();
+    if (c == 0) {
+        throw std::logic_error("Not enough non missing values");
+    }
+    std::vector<size_t> ranks(qs.size());
+    for (size_t i = 0; i < qs.size(); ++i) {
+        ranks[i] = std::min<size_t>(qs[i] * c, c - 1);
+    }
+    return ranks;
+}
+
+template <typename T>
+std::vector<T> Series<T>::select_cached(std::span<const size_t> ranks) {
+    std::vector<size_t> order(ranks.begin(), ranks.end());
+    std::sort(order.begin(), order.end());
+    order.erase(std::unique(order.begin(), order.end()), order.end());
+    select_middle_first(order);
+    std::vector<T> res(ranks.size());
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        res[i] = sorted[ranks[i]];
+    }
+    return res;
+}
+
+template <typename T>
+std::vector<T> Series<T>::select_lean(std::span<const size_t> ranks) const {
+    std::vector<T> res(ranks.size());
+    if (!needs_update) {
+        for (size_t i = 0; i < ranks.size(); ++i) {
+            res[i] = sorted[ranks[i]];
+        }
+        return res;
+    }
+    std::vector<size_t> order(ranks.begin(), ranks.end());
+    std::sort(order.begin(), order.end());
+    order.erase(std::unique(order.begin(), order.end()), order.end());
+    std::vector<T> buf = filter();
+    select_ranks(buf, 0, order);
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        res[i] = buf[ranks[i]];
+    }
+    return res;
+}
+
+template <typename T>
+void Series<T>::select_middle_first(std::span<const size_t> ranks) {
+    if (ranks.empty()) {
+        return;
+    }
+    size_t middle = ranks.size() / 2;
+    select(ranks[middle]);
+    select_middle_first(ranks.first(middle));
+    select_middle_first(ranks.subspan(middle + 1));
+}
+
+template <typename T>
+void Series<T>::select_ranks(std::span<T> values, size_t first, std::span<const size_t> ranks) {
+    if (ranks.empty()) {
+        return;
     }
+    size_t middle = ranks.size() / 2;
+    size_t at     = ranks[middle] - first;
+    std::nth_element(values.begin(), values.begin() + at, values.end());
+    select_ranks(values.first(at), first, ranks.first(middle));
+    select_ranks(values.subspan(at + 1), ranks[middle] + 1, ranks.subspan(middle + 1));
 }
 
 template <typename T>
-std::vector<T> Series<T>::filter() {
+std::vector<T> Series<T>::filter() const {
     std::vector<T> res(count());
     size_t         j = 0;
     for (size_t i = 0; i < size(); ++i) {
-        if (storage[i].has_value()) {
-            res[j++] = storage[i].value();
+        if (valid(i)) {
+            res[j++] = storage[i];
         }
     }
     return res;
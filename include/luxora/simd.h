@@ -0,0 +1,116 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+
+namespace Luxora {
+
+/// Instruction set used by vectorized kernels.
+enum class SimdLevel {
+    Scalar, ///< Portable fallback.
+    SSE42,  ///<
+    AVX2,   ///<
+    AVX512, ///< AVX-512 Foundation.
+};
+
+/// Best instruction set supported by the running CPU, detected once.
+SimdLevel simd_level();
+
+/// Width of a block classified by scan_block.
+constexpr size_t scan_block_size = 64;
+
+/// Positions of structural characters within a block, bit i stands for byte i.
+struct StructuralMasks {
+    uint64_t delimiter = 0; ///<
+    uint64_t quote     = 0; ///< `"`
+    uint64_t newline   = 0; ///< `\n` or `\r`
+
+    uint64_t any() const {
+        return delimiter | quote | newline;
+    }
+};
+
+/**
+ * Classify scan_block_size bytes at once.
+ *
+ * @param block At least scan_block_size readable bytes.
+ * @param level Instruction set, the one of the running CPU by default.
+ */
+StructuralMasks scan_block(const char* block, char delimiter, SimdLevel level = simd_level());
+
+/**
+ * Finds structural characters of a buffer a block at a time.
+ *
+ * Every block is classified once, consecutive queries within it are answered from the bitmask.
+ */
+class StructuralScanner {
+    const char* end;
+    char        delimiter;
+    SimdLevel   level;
+    bool        quotes;
+    const char* block = nullptr;
+    uint64_t    mask  = 0;
+
+  public:
+    /// @param quotes Whether quotes are structural, input without quotes only needs delimiters and line breaks.
+    StructuralScanner(std::string_view buffer, char delimiter, bool quotes = true, SimdLevel level = simd_level());
+
+    /// Position of the first delimiter, quote or line break at or after p, end of buffer if there is none.
+    const char* next(const char* p);
+
+  private:
+    void load(const char* p);
+
+    uint64_t select(const StructuralMasks& masks) const {
+        return quotes ? masks.any() : masks.delimiter | masks.newline;
+    }
+};
+
+/// Types that aggregate and squared_deviations have kernels for.
+template <typename T>
+concept Reducible = std::same_as<T, float> || std::same_as<T, double> || std::same_as<T, int32_t> ||
+                    std::same_as<T, int64_t> || std::same_as<T, size_t>;
+
+/// Type that values of T are summed in, integers are summed as doubles so that sums and squares cannot overflow.
+template <typename T>
+using SumType = std::conditional_t<std::is_integral_v<T>, double, T>;
+
+/// Reductions over the values of a column that are present.
+template <typename T>
+struct Aggregates {
+    size_t     count = 0;                                ///<
+    SumType<T> sum   = 0;                                ///<
+    T          min   = std::numeric_limits<T>::max();    ///< max() if no value is present.
+    T          max   = std::numeric_limits<T>::lowest(); ///< lowest() if no value is present.
+
+    /// Combine with aggregates of other values.
+    void merge(const Aggregates& other) {
+        count += other.count;
+        sum += other.sum;
+        min = other.min < min ? other.min : min;
+        max = other.max > max ? other.max : max;
+    }
+};
+
+/**
+ * Count, sum, min and max of the values whose bit is set in validity.
+ *
+ * Missing values have to hold 0, so they are summed as they are; min and max blend them out with a mask
+ * made from the validity bits instead of branching on every value.
+ *
+ * @param validity Words of a Bitmap of n bits, see Bitmap::data().
+ * @param level Instruction set, the one of the running CPU by default.
+ */
+template <Reducible T>
+Aggregates<T> aggregate(const T* values, const uint64_t* validity, size_t n, SimdLevel level = simd_level());
+
+/// Sum of (x - mean)^2 over the values whose bit is set in validity, taken in SumType<T>.
+template <Reducible T>
+SumType<T> squared_deviations(const T* values, const uint64_t* validity, size_t n, SumType<T> mean,
+                              SimdLevel level = simd_level());
+
+} // namespace Luxora
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace Luxora {
+
+/**
+ * Approximate quantiles of a stream of numbers in bounded memory (a KLL sketch).
+ *
+ * Values are kept in levels, a value of level h stands for 2^h values. A full level is sorted and every other
+ * value moves up a level, so memory grows with log(n) levels of at most k values. With the default k the rank of
+ * a returned quantile is within about 1% of the count. Sketches of parts of a column, built by other batches or
+ * threads, merge into a sketch of the whole.
+ */
+class QuantileSketch {
+    size_t                           k;
+    std::vector<std::vector<double>> levels;
+    size_t                           n        = 0;
+    size_t                           retained = 0;
+    /// Values a level may hold before it is compacted, lower levels hold fewer.
+    std::vector<size_t> capacities;
+    /// Values all levels hold together, more are compacted.
+    size_t           limit = 0;
+    std::minstd_rand coin;
+
+  public:
+    /// Values kept by the largest level, more give smaller errors.
+    static constexpr size_t default_k = 200;
+
+    explicit QuantileSketch(size_t k = default_k);
+
+    ///
+    void add(double x);
+    /// Add values of other, e.g. a sketch of another batch.
+    void merge(const QuantileSketch& other);
+
+    /// Values added.
+    size_t count() const {
+        return n;
+    }
+    /// Values kept.
+    size_t size() const {
+        return retained;
+    }
+
+    /// Approximate value that is greater than q fraction of values, like Series::quantile.
+    double quantile(float q) const;
+    /// Approximate quantile(q) for every q of qs, retained values are ordered once.
+    std::vector<double> quantiles(std::span<const float> qs) const;
+
+  private:
+    /// Add a top level, capacities of lower levels shrink.
+    void grow();
+    /// Compact the lowest full level into the next one while more values are kept than levels hold.
+    void compress();
+};
+
+} // namespace Luxora
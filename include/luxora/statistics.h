@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <ostream>
+
+namespace Luxora {
+
+/**
+ * Summary of a numeric column: count, sum, extremes and spread.
+ *
+ * Parts of a column are combined with Chan's parallel variance formula, so the result does not depend on how the
+ * column was split into blocks, batches or threads.
+ */
+struct Statistics {
+    size_t count      = 0; ///< Non missing values.
+    size_t null_count = 0; ///<
+    double sum        = 0; ///<
+    double mean       = 0; ///<
+    double m2         = 0; ///< Sum of squared deviations from the mean.
+    double min        = std::numeric_limits<double>::infinity();  ///<
+    double max        = -std::numeric_limits<double>::infinity(); ///<
+
+    /// Add one value with Welford's update.
+    void add(double x);
+    /// Combine with statistics of other rows.
+    void merge(const Statistics& other);
+
+    double range() const;    ///<
+    double variance() const; ///< Population variance, like Series::variance.
+    double stddev() const;   ///<
+};
+
+/// One statistic per line, spread only if there are values.
+std::ostream& operator<<(std::ostream& os, const Statistics& stats);
+
+} // namespace Luxora
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "luxora/csv.h"
+#include "luxora/dataframe.h"
+#include "luxora/series.h"
+#include "luxora/sketch.h"
+#include "luxora/statistics.h"
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Luxora {
+
+/// Statistics of a numeric column collected batch by batch, every batch is described and merged.
+using StreamStats = Statistics;
+
+/// Reads a CSV file a batch of records at a time into a DataFrame.
+class BatchReader {
+    MappedFile               file;
+    std::string_view         body;
+    std::string              sampled;
+    std::vector<std::string> header;
+    size_t                   batch_rows;
+    LoadOptions              options;
+
+  public:
+    BatchReader(const std::string& filename, size_t batch_rows, const LoadOptions& options = {});
+
+    /// All column names of the file.
+    const std::vector<std::string>& column_names() const {
+        return header;
+    }
+    /// Types of the loaded columns over all records, declared types as they are. The file is scanned once.
+    std::unordered_map<std::string, ColumnType> column_types() const;
+
+    /**
+     * Replace content of df with the next batch.
+     *
+     * Pages of the previous batch are released, so memory stays bounded by the batch size.
+     *
+     * @returns false when the file is exhausted.
+     */
+    bool next(DataFrame& df);
+};
+
+/**
+ * Processes a CSV file that does not fit in memory in batches of rows.
+ *
+ * Column types are found by a scan of the whole file and declared for every batch, so a column keeps its type
+ * across batches. Transformations are queued and run when the result is saved. Statistics they depend on,
+ * like min/max for MinMax normalization or the mean for imputation, are collected in passes
+ * planned before: a new pass is needed only when a step reads a column changed by a step of the current pass.
+ */
+class Stream {
+    enum class StepKind {
+        Normalize, ///<
+        Impute,    ///<
+    };
+    struct Step {
+        StepKind    kind;
+        std::string column;
+        std::string target;
+        NormMethod  method   = MinMax;
+        Strategy    strategy = Strategy::Mean;
+    };
+
+    std::string              filename;
+    size_t                   batch_rows;
+    LoadOptions              options;
+    std::vector<std::string> header;
+    std::vector<Step>        steps;
+
+  public:
+    Stream(std::string filename, size_t batch_rows = 1 << 16, LoadOptions options = {});
+
+    /// Statistics of a column after the queued steps.
+    StreamStats stats(const std::string& column);
+    /// Approximate quantiles of a column after the queued steps, sketches of batches are merged.
+    QuantileSketch sketch(const std::string& column);
+    /// Values more than 1.5 IQR away from approximate quartiles, one pass for the sketch and one to collect them.
+    std::vector<double> outliers(const std::string& column);
+
+    /// Queue normalization of a column, see DataFrame::normalize.
+    Stream& normalize(const std::string& column, const std::string& new_name = "", NormMethod method = MinMax);
+    /// Queue imputation of a column, only Strategy::Mean is supported.
+    Stream& fill_na(const std::string& column, Strategy strategy = Strategy::Mean);
+
+    /// Run queued steps over the file and write the result.
+    void save(const std::string& output);
+    ///
+    void save(std::ostream& os);
+
+  private:
+    /// Columns to load for a statistic of column after all queued steps.
+    std::vector<std::string> inputs_of(const std::string& column) const;
+    /// Collect statistics every queued step depends on.
+    std::vector<StreamStats> plan();
+    /// Run over all batches applying the first `applied` steps, loading only the listed columns.
+    template <class F>
+    void pass(size_t applied, const std::vector<StreamStats>& resolved, std::vector<std::string> columns, F on_batch);
+    /// Apply the first `applied` steps to a batch.
+    void apply(DataFrame& df, size_t applied, const std::vector<StreamStats>& resolved) const;
+};
+
+} // namespace Luxora
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "luxora/bitmap.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+namespace Luxora {
+
+/**
+ * Strings stored back to back in one buffer, string i ends at offset i and starts where string i - 1 ends.
+ *
+ * Offsets are 32 bits wide until the buffer outgrows them, then 64 bits wide.
+ * Strings can only be added at the end, changing one means building a new arena.
+ */
+class StringArena {
+    AlignedVector<char>     bytes;
+    AlignedVector<uint32_t> narrow;
+    AlignedVector<uint64_t> wide;
+    bool                    is_wide = false;
+
+  public:
+    using value_type = std::string_view;
+
+    size_t size() const {
+        return is_wide ? wide.size() : narrow.size();
+    }
+    bool empty() const {
+        return size() == 0;
+    }
+    /// Where string i ends.
+    uint64_t offset(size_t i) const {
+        return is_wide ? wide[i] : narrow[i];
+    }
+    std::string_view operator[](size_t i) const {
+        uint64_t from = i ? offset(i - 1) : 0;
+        return {bytes.data() + from, offset(i) - from};
+    }
+
+    /// Characters of all strings.
+    const char* data() const {
+        return bytes.data();
+    }
+    char* data() {
+        return bytes.data();
+    }
+    /// Number of characters of all strings.
+    size_t length() const {
+        return bytes.size();
+    }
+
+    /// @param characters Expected number of characters of all strings.
+    void reserve(size_t n, size_t characters = 0) {
+        if (is_wide) {
+            wide.reserve(n);
+        } else {
+            narrow.reserve(n);
+        }
+        bytes.reserve(characters);
+    }
+    void push_back(std::string_view s) {
+        bytes.insert(bytes.end(), s.begin(), s.end());
+        push_offset(bytes.size());
+    }
+    /// Strings of tail after the last one.
+    void append(const StringArena& tail) {
+        uint64_t base = bytes.size();
+        bytes.insert(bytes.end(), tail.bytes.begin(), tail.bytes.end());
+        reserve(size() + tail.size());
+        for (size_t i = 0; i < tail.size(); ++i) {
+            push_offset(base + tail.offset(i));
+        }
+    }
+    void clear() {
+        bytes.clear();
+        narrow.clear();
+        wide.clear();
+        is_wide = false;
+    }
+
+    bool operator==(const StringArena& other) const {
+        if (size() != other.size() || bytes != other.bytes) {
+            return false;
+        }
+        for (size_t i = 0; i < size(); ++i) {
+            if (offset(i) != other.offset(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+  private:
+    void push_offset(uint64_t end) {
+        if (!is_wide && end > std::numeric_limits<uint32_t>::max()) {
+            wide.assign(narrow.begin(), narrow.end());
+            narrow  = {};
+            is_wide = true;
+        }
+        if (is_wide) {
+            wide.push_back(end);
+        } else {
+            narrow.push_back(end);
+        }
+    }
+};
+
+} // namespace Luxora
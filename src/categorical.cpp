@@ -0,0 +1,227 @@
+#include <limits>
+#include <luxora/categorical.h>
+#include <stdexcept>
+
+namespace Luxora {
+
+Categorical::Categorical() : categories_(std::make_shared<const std::vector<std::string>>()) {}
+
+Categorical::Categorical(std::vector<std::string> categories, std::span<const uint32_t> codes, Bitmap validity)
+    : categories_(std::make_shared<const std::vector<std::string>>(std::move(categories))) {
+    if (codes.size() != validity.size()) {
+        throw std::invalid_argument("Codes and validity differ in size");
+    }
+    widen();
+    push(codes, validity);
+}
+
+Categorical::Categorical(const Series<std::string>& strings) : Categorical() {
+    encode(strings);
+}
+
+Series<std::string> Categorical::decode() const {
+    StringArena values;
+    values.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        values.push_back(valid(i) ? std::string_view((*categories_)[code(i)]) : std::string_view());
+    }
+    return Series<std::string>(std::move(values), Bitmap(validity_));
+}
+
+std::optional<uint32_t> Categorical::find(std::string_view category) const {
+    for (size_t k = 0; k < categories_->size(); ++k) {
+        if ((*categories_)[k] == category) {
+            return k;
+        }
+    }
+    return {};
+}
+
+std::vector<size_t> Categorical::indices_of(std::string_view category) const {
+    std::vector<size_t>     res;
+    std::optional<uint32_t> wanted = find(category);
+    if (!wanted) {
+        return res;
+    }
+    std::visit(
+        [&](const auto& c) {
+            for (size_t i = 0; i < c.size(); ++i) {
+                if (c[i] == *wanted && valid(i)) {
+                    res.push_back(i);
+                }
+            }
+        },
+        codes);
+    return res;
+}
+
+std::vector<size_t> Categorical::counts() const {
+    std::vector<size_t> res(categories_->size());
+    std::visit(
+        [&](const auto& c) {
+            for (size_t i = 0; i < c.size(); ++i) {
+                res[c[i]] += valid(i);
+            }
+        },
+        codes);
+    return res;
+}
+
+std::vector<std::vector<size_t>> Categorical::groups() const {
+    std::vector<std::vector<size_t>> res(categories_->size());
+    std::visit(
+        [&](const auto& c) {
+            for (size_t i = 0; i < c.size(); ++i) {
+                if (valid(i)) {
+                    res[c[i]].push_back(i);
+                }
+            }
+        },
+        codes);
+    return res;
+}
+
+std::byte* Categorical::data() {
+    return std::visit([](auto& c) { return reinterpret_cast<std::byte*>(c.data()); }, codes);
+}
+
+const std::byte* Categorical::data() const {
+    return std::visit([](const auto& c) { return reinterpret_cast<const std::byte*>(c.data()); }, codes);
+}
+
+size_t Categorical::size() const {
+    return validity_.size();
+}
+
+size_t Categorical::type_size() const {
+    return std::visit([](const auto& c) { return sizeof(c[0]); }, codes);
+}
+
+std::optional<std::string> Categorical::string_at(size_t index) const {
+    if (auto category = view_at(index)) {
+        return std::string(*category);
+    }
+    return {};
+}
+
+void Categorical::write_at(std::ostream& os, size_t index, std::string_view none) const {
+    os << view_at(index).value_or(none);
+}
+
+void Categorical::append(SeriesUntyped&& tail) {
+    if (tail.type() == typeid(Categorical)) {
+        auto&                 other = static_cast<Categorical&>(tail);
+        std::vector<uint32_t> codes_of = remap(*other.categories_);
+        std::vector<uint32_t> values(other.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = other.valid(i) ? codes_of[other.code(i)] : 0;
+        }
+        push(values, other.validity_);
+        return;
+    }
+    if (tail.type() == typeid(std::string)) {
+        encode(static_cast<const Series<std::string>&>(tail));
+        return;
+    }
+    throw std::invalid_argument("Appended values have an incompatible type");
+}
+
+void Categorical::reserve(size_t n) {
+    std::visit([n](auto& c) { c.reserve(n); }, codes);
+    validity_.reserve(n);
+}
+
+bool Categorical::operator==(const Categorical& other) const {
+    if (size() != other.size() || validity_ != other.validity_) {
+        return false;
+    }
+    for (size_t i = 0; i < size(); ++i) {
+        if (view_at(i) != other.view_at(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CodeMap Categorical::known() const {
+    CodeMap res;
+    for (size_t k = 0; k < categories_->size(); ++k) {
+        res.emplace((*categories_)[k], k);
+    }
+    return res;
+}
+
+std::vector<uint32_t> Categorical::remap(const std::vector<std::string>& tail) {
+    CodeMap                  codes_of = known();
+    std::vector<uint32_t>    res(tail.size());
+    std::vector<std::string> added;
+    for (size_t k = 0; k < tail.size(); ++k) {
+        auto [it, inserted] = codes_of.try_emplace(tail[k], codes_of.size());
+        if (inserted) {
+            added.push_back(tail[k]);
+        }
+        res[k] = it->second;
+    }
+    add_categories(std::move(added));
+    return res;
+}
+
+void Categorical::encode(const Series<std::string>& strings) {
+    CodeMap                  codes_of = known();
+    std::vector<uint32_t>    values(strings.size());
+    std::vector<std::string> added;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (!strings.valid(i)) {
+            continue;
+        }
+        std::string_view cell = strings.values()[i];
+        auto             it   = codes_of.find(cell);
+        if (it == codes_of.end()) {
+            it = codes_of.emplace(cell, codes_of.size()).first;
+            added.emplace_back(cell);
+        }
+        values[i] = it->second;
+    }
+    add_categories(std::move(added));
+    push(values, strings.validity());
+}
+
+void Categorical::add_categories(std::vector<std::string>&& added) {
+    if (added.empty()) {
+        return;
+    }
+    // Copies of this Series keep the old dictionary.
+    auto grown = std::make_shared<std::vector<std::string>>(*categories_);
+    grown->insert(grown->end(), std::make_move_iterator(added.begin()), std::make_move_iterator(added.end()));
+    categories_ = std::move(grown);
+    widen();
+}
+
+void Categorical::push(std::span<const uint32_t> tail, const Bitmap& validity) {
+    std::visit(
+        [tail](auto& c) {
+            using Code = typename std::decay_t<decltype(c)>::value_type;
+            for (uint32_t code : tail) {
+                c.push_back(static_cast<Code>(code));
+            }
+        },
+        codes);
+    validity_.append(validity);
+}
+
+void Categorical::widen() {
+    size_t n  = categories_->size();
+    auto   to = [this](auto wider) {
+        using Code = decltype(wider);
+        if (!std::holds_alternative<AlignedVector<Code>>(codes)) {
+            codes = std::visit([](const auto& c) { return Codes(AlignedVector<Code>(c.begin(), c.end())); }, codes);
+        }
+    };
+    if (n > std::numeric_limits<uint16_t>::max() + size_t(1)) {
+        to(uint32_t());
+    } else if (n > std::numeric_limits<uint8_t>::max() + size_t(1) && type_size() < sizeof(uint16_t)) {
+        to(uint16_t());
+    }
+}
+
+} // namespace Luxora
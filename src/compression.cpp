@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cstring>
+#include <luxora/compression.h>
+#include <memory>
+#include <stdexcept>
+
+#ifdef LUXORA_HAS_ZLIB
+#include <zlib.h>
+#endif
+#ifdef LUXORA_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace Luxora {
+
+namespace {
+
+/// Produces decompressed content a buffer at a time.
+class Codec {
+  public:
+    virtual ~Codec() = default;
+    /// Fill at most capacity bytes, 0 at the end of the input.
+    virtual size_t read(char* out, size_t capacity) = 0;
+};
+
+class PlainCodec : public Codec {
+    std::string_view input;
+
+  public:
+    PlainCodec(std::string_view input) : input(input) {}
+
+    size_t read(char* out, size_t capacity) override {
+        size_t n = std::min(capacity, input.size());
+        std::memcpy(out, input.data(), n);
+        input.remove_prefix(n);
+        return n;
+    }
+};
+
+#ifdef LUXORA_HAS_ZLIB
+class GzipCodec : public Codec {
+    z_stream stream{};
+    bool     ended = false;
+
+  public:
+    GzipCodec(std::string_view input) {
+        // 32 enables detection of the gzip or zlib header.
+        if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+            throw std::runtime_error("Can not initialize zlib");
+        }
+        stream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = input.size();
+    }
+    ~GzipCodec() override {
+        inflateEnd(&stream);
+    }
+
+    size_t read(char* out, size_t capacity) override {
+        stream.next_out  = reinterpret_cast<Bytef*>(out);
+        stream.avail_out = capacity;
+        while (stream.avail_out > 0 && !ended) {
+            int status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                // Concatenated members, e.g. from parallel gzip tools, form a single file.
+                ended = stream.avail_in == 0;
+                inflateReset(&stream);
+            } else if (status == Z_BUF_ERROR && stream.avail_in == 0) {
+                // The input ends inside a member.
+                throw std::runtime_error("Truncated gzip input");
+            } else if (status != Z_OK) {
+                throw std::runtime_error("Corrupted gzip input");
+            }
+        }
+        return capacity - stream.avail_out;
+    }
+};
+#endif
+
+#ifdef LUXORA_HAS_ZSTD
+class ZstdCodec : public Codec {
+    ZSTD_DStream* stream;
+    ZSTD_inBuffer in;
+    bool          ended = false;
+
+  public:
+    ZstdCodec(std::string_view input) : stream(ZSTD_createDStream()), in{input.data(), input.size(), 0} {
+        if (!stream) {
+            throw std::runtime_error("Can not initialize zstd");
+        }
+    }
+    ~ZstdCodec() override {
+        ZSTD_freeDStream(stream);
+    }
+
+    size_t read(char* out, size_t capacity) override {
+        ZSTD_outBuffer buffer{out, capacity, 0};
+        while (buffer.pos < buffer.size && !ended) {
+            size_t status = ZSTD_decompressStream(stream, &buffer, &in);
+            if (ZSTD_isError(status)) {
+                throw std::runtime_error(std::string("Corrupted zstd input: ") + ZSTD_getErrorName(status));
+            }
+            // With room left in the output everything decoded so far is flushed, the frame has to be complete.
+            if (in.pos == in.size && buffer.pos < buffer.size) {
+                if (status != 0) {
+                    throw std::runtime_error("Truncated zstd input");
+                }
+                ended = true;
+            }
+        }
+        return buffer.pos;
+    }
+};
+#endif
+
+std::unique_ptr<Codec> make_codec(Compression compression, std::string_view input) {
+    switch (compression) {
+#ifdef LUXORA_HAS_ZLIB
+    case Compression::Gzip:
+        return std::make_unique<GzipCodec>(input);
+#endif
+#ifdef LUXORA_HAS_ZSTD
+    case Compression::Zstd:
+        return std::make_unique<ZstdCodec>(input);
+#endif
+    case Compression::None:
+        return std::make_unique<PlainCodec>(input);
+    default:
+        throw std::runtime_error("Luxora was built without support for this compression format");
+    }
+}
+
+} // namespace
+
+Compression detect_compression(std::string_view head) {
+    if (head.starts_with("\x1f\x8b")) {
+        return Compression::Gzip;
+    }
+    if (head.starts_with("\x28\xb5\x2f\xfd")) {
+        return Compression::Zstd;
+    }
+    return Compression::None;
+}
+
+bool compression_supported(Compression compression) {
+    switch (compression) {
+    case Compression::Gzip:
+#ifdef LUXORA_HAS_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    case Compression::Zstd:
+#ifdef LUXORA_HAS_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return true;
+    }
+}
+
+Decompressor::Decompressor(const std::string& filename, size_t buffer_size, size_t buffers)
+    : input(filename), compression(detect_compression(input.view())), ring(std::max<size_t>(buffers, 2)),
+      filled(ring.size()) {
+    if (!compression_supported(compression)) {
+        throw std::runtime_error("Luxora was built without support for the compression of " + filename);
+    }
+    for (auto& buffer : ring) {
+        buffer.resize(std::max<size_t>(buffer_size, 1));
+    }
+    worker = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+Decompressor::~Decompressor() {
+    worker.request_stop();
+    changed.notify_all();
+}
+
+std::string_view Decompressor::next() {
+    std::unique_lock lock(mutex);
+    if (holding) {
+        ++consumed;
+        holding = false;
+        changed.notify_all();
+    }
+    changed.wait(lock, [this] { return produced > consumed || finished; });
+    if (produced > consumed) {
+        size_t k = consumed % ring.size();
+        holding  = true;
+        return {ring[k].data(), filled[k]};
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return {};
+}
+
+void Decompressor::run(std::stop_token stop) {
+    try {
+        auto codec = make_codec(compression, input.view());
+        while (true) {
+            size_t k;
+            {
+                std::unique_lock lock(mutex);
+                // The buffer of the consumer is the oldest one, it is free once handed back.
+                if (!changed.wait(lock, stop, [this] { return produced < consumed + ring.size(); })) {
+                    return;
+                }
+                k = produced % ring.size();
+            }
+            size_t n = codec->read(ring[k].data(), ring[k].size());
+            std::lock_guard lock(mutex);
+            if (n == 0) {
+                break;
+            }
+            filled[k] = n;
+            ++produced;
+            changed.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard lock(mutex);
+        error = std::current_exception();
+    }
+    std::lock_guard lock(mutex);
+    finished = true;
+    changed.notify_all();
+}
+
+} // namespace Luxora
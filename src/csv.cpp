@@ -0,0 +1,1275 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <glob.h>
+#include <luxora/csv.h>
+#include <luxora/parallel.h>
+#include <luxora/parse.h>
+#include <luxora/simd.h>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Luxora {
+
+MappedFile::MappedFile(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file `" + filename + "`: " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file `" + filename + "`: " + std::strerror(errno));
+    }
+    length = st.st_size;
+    if (length > 0) {
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map file `" + filename + "`: " + std::strerror(errno));
+        }
+        ::madvise(mapped, length, MADV_SEQUENTIAL);
+        begin = static_cast<const char*>(mapped);
+    }
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (begin) {
+        ::munmap(const_cast<char*>(begin), length);
+    }
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : begin(other.begin), length(other.length) {
+    other.begin  = nullptr;
+    other.length = 0;
+}
+
+void MappedFile::release(std::string_view processed) const {
+    static const size_t page = ::sysconf(_SC_PAGESIZE);
+    uintptr_t           from = (reinterpret_cast<uintptr_t>(processed.data()) + page - 1) / page * page;
+    uintptr_t           to   = (reinterpret_cast<uintptr_t>(processed.data()) + processed.size()) / page * page;
+    if (begin && from < to) {
+        ::madvise(reinterpret_cast<void*>(from), to - from, MADV_DONTNEED);
+    }
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    std::swap(begin, other.begin);
+    std::swap(length, other.length);
+    return *this;
+}
+
+NaTokens::NaTokens(std::vector<std::string> tokens) : tokens(std::move(tokens)) {
+    for (const auto& token : this->tokens) {
+        lengths |= uint64_t(1) << std::min<size_t>(token.size(), 63);
+    }
+}
+
+NaTokens LoadOptions::na_for(const std::string& column) const {
+    auto it = column_na_tokens.find(column);
+    return it == column_na_tokens.end() ? NaTokens(na_tokens) : NaTokens(it->second);
+}
+
+bool is_pattern(std::string_view path) {
+    struct stat st;
+    return path.find_first_of("*?[") != std::string_view::npos && ::stat(std::string(path).c_str(), &st) != 0;
+}
+
+std::vector<std::string> expand_pattern(const std::string& pattern) {
+    glob_t matches;
+    int    status = glob(pattern.c_str(), 0, nullptr, &matches);
+    if (status != 0) {
+        if (status != GLOB_NOMATCH) {
+            globfree(&matches);
+        }
+        throw std::runtime_error("No file matches " + pattern);
+    }
+    std::vector<std::string> files(matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+    globfree(&matches);
+    return files;
+}
+
+void parse_schema(std::string_view schema, LoadOptions& options) {
+    std::vector<std::string> header = parse_header(schema);
+    auto                     find   = [&header](const std::string& name) {
+        return static_cast<size_t>(std::find(header.begin(), header.end(), name) - header.begin());
+    };
+    size_t column = find("column"), type = find("type"), na = find("na"), keep = find("keep");
+    if (column == header.size() || type == header.size()) {
+        throw std::invalid_argument("Schema needs `column` and `type` fields");
+    }
+
+    std::vector<StringColumnBuilder> fields(header.size());
+    std::vector<ColumnBuilder*>      sinks;
+    for (auto& field : fields) {
+        sinks.push_back(&field);
+    }
+    size_t                                      records = parse_records(schema, sinks, ',');
+    std::vector<std::unique_ptr<SeriesUntyped>> values;
+    for (auto& field : fields) {
+        values.push_back(field.finish());
+    }
+    auto cell = [&values](size_t field, size_t record) -> std::string {
+        return field < values.size() ? values[field]->string_at(record).value_or("") : "";
+    };
+
+    options.columns.clear();
+    for (size_t i = 0; i < records; ++i) {
+        std::string name = cell(column, i);
+        std::string kind = cell(type, i);
+        if (kind == "int64") {
+            options.column_types[name] = ColumnType::Int64;
+        } else if (kind == "double") {
+            options.column_types[name] = ColumnType::Double;
+        } else if (kind == "string") {
+            options.column_types[name] = ColumnType::String;
+        } else {
+            throw std::invalid_argument("Unknown type `" + kind + "` of column `" + name + "`");
+        }
+        if (std::string tokens = cell(na, i); !tokens.empty()) {
+            auto& column_tokens = options.column_na_tokens[name];
+            column_tokens.clear();
+            for (size_t start = 0; start < tokens.size();) {
+                size_t stop = std::min(tokens.find(' ', start), tokens.size());
+                if (stop > start) {
+                    column_tokens.push_back(tokens.substr(start, stop - start));
+                }
+                start = stop + 1;
+            }
+        }
+        if (std::string kept = cell(keep, i); kept != "no" && kept != "false") {
+            options.columns.push_back(name);
+        }
+    }
+}
+
+void read_schema(const std::string& filename, LoadOptions& options) {
+    MappedFile file(filename);
+    parse_schema(file.view(), options);
+}
+
+StringColumnBuilder::StringColumnBuilder(NaTokens na, size_t max_categories)
+    : na(std::move(na)), max_categories(max_categories) {}
+
+void StringColumnBuilder::push(std::string_view cell) {
+    if (na.contains(cell)) {
+        push_na();
+        return;
+    }
+    valid.push_back(true);
+    if (encoding()) {
+        auto it = codes_of.find(cell);
+        if (it != codes_of.end()) {
+            codes.push_back(it->second);
+            return;
+        }
+        if (categories.size() < max_categories) {
+            codes.push_back(categories.size());
+            categories.emplace_back(cell);
+            codes_of.emplace(categories.back(), codes.back());
+            return;
+        }
+        decode();
+    }
+    cells.push_back(cell);
+}
+
+void StringColumnBuilder::push_na() {
+    if (encoding()) {
+        codes.push_back(0);
+    } else {
+        cells.push_back({});
+    }
+    valid.push_back(false);
+}
+
+size_t StringColumnBuilder::size() const {
+    return valid.size();
+}
+
+void StringColumnBuilder::reserve(size_t n) {
+    if (encoding()) {
+        codes.reserve(n);
+    } else {
+        cells.reserve(n);
+    }
+    valid.reserve(n);
+}
+
+void StringColumnBuilder::merge(ColumnBuilder& other) {
+    auto& tail = dynamic_cast<StringColumnBuilder&>(other);
+    if (encoding() && tail.encoding()) {
+        // Codes of tail are translated into this dictionary.
+        std::vector<uint32_t> translated(tail.categories.size());
+        for (size_t k = 0; k < translated.size() && encoding(); ++k) {
+            auto [it, inserted] = codes_of.try_emplace(tail.categories[k], categories.size());
+            if (inserted) {
+                categories.push_back(tail.categories[k]);
+            }
+            translated[k] = it->second;
+            if (categories.size() > max_categories) {
+                decode();
+            }
+        }
+        if (encoding()) {
+            codes.reserve(codes.size() + tail.codes.size());
+            for (uint32_t code : tail.codes) {
+                codes.push_back(translated.empty() ? 0 : translated[code]);
+            }
+            valid.append(tail.valid);
+            tail.codes.clear();
+            tail.valid.clear();
+            return;
+        }
+    }
+    decode();
+    tail.decode();
+    cells.append(tail.cells);
+    valid.append(tail.valid);
+    tail.cells.clear();
+    tail.valid.clear();
+}
+
+std::unique_ptr<SeriesUntyped> StringColumnBuilder::finish() {
+    if (encoding() && !categories.empty() && categories.size() * 2 <= valid.count()) {
+        return std::make_unique<Categorical>(std::move(categories), codes, std::move(valid));
+    }
+    decode();
+    return std::make_unique<Series<std::string>>(std::move(cells), std::move(valid));
+}
+
+void StringColumnBuilder::decode() {
+    if (!encoding()) {
+        return;
+    }
+    cells.reserve(codes.capacity());
+    for (size_t i = 0; i < codes.size(); ++i) {
+        cells.push_back(valid[i] ? std::string_view(categories[codes[i]]) : std::string_view());
+    }
+    max_categories = 0;
+    categories     = {};
+    codes_of       = {};
+    codes          = {};
+}
+
+namespace {
+
+/// Guessed doubles are finite: from_chars also reads words like `nan` and `inf`, which are text in a CSV.
+std::optional<double> parse_finite(std::string_view cell) {
+    auto value = parse_number<double>(cell);
+    return value && std::isfinite(*value) ? value : std::nullopt;
+}
+
+} // namespace
+
+ColumnType classify(std::string_view cell) {
+    if (cell.empty() || parse_number<int64_t>(cell)) {
+        return ColumnType::Int64;
+    }
+    if (parse_finite(cell)) {
+        return ColumnType::Double;
+    }
+    return ColumnType::String;
+}
+
+TypeScanBuilder::TypeScanBuilder(NaTokens na) : na(std::move(na)) {}
+
+void TypeScanBuilder::push(std::string_view cell) {
+    ++cells;
+    if (type_ != ColumnType::String && !na.contains(cell)) {
+        type_ = std::max(type_, classify(cell));
+    }
+}
+
+void TypeScanBuilder::push_na() {
+    ++cells;
+}
+
+size_t TypeScanBuilder::size() const {
+    return cells;
+}
+
+void TypeScanBuilder::reserve(size_t) {}
+
+void TypeScanBuilder::merge(ColumnBuilder& other) {
+    auto& tail = dynamic_cast<TypeScanBuilder&>(other);
+    type_      = std::max(type_, tail.type_);
+    cells += tail.cells;
+}
+
+std::unique_ptr<SeriesUntyped> TypeScanBuilder::finish() {
+    return nullptr;
+}
+
+NumberColumnBuilder::NumberColumnBuilder(ColumnType type, NaTokens na, bool fixed)
+    : type_(type), na(std::move(na)), fixed(fixed) {
+    if (type == ColumnType::String) {
+        throw std::invalid_argument("NumberColumnBuilder only builds numeric columns");
+    }
+}
+
+void NumberColumnBuilder::push(std::string_view cell) {
+    if (failed_ || na.contains(cell)) {
+        push_na();
+        return;
+    }
+    if (fixed) {
+        if (type_ == ColumnType::Int64) {
+            integers.push_back(parse_number_or_throw<int64_t>(cell));
+        } else {
+            reals.push_back(parse_number_or_throw<double>(cell));
+        }
+        valid.push_back(true);
+        return;
+    }
+    if (type_ == ColumnType::Int64) {
+        if (auto value = parse_number<int64_t>(cell)) {
+            integers.push_back(*value);
+            valid.push_back(true);
+            return;
+        }
+        promote();
+    }
+    if (auto value = parse_finite(cell)) {
+        reals.push_back(*value);
+        valid.push_back(true);
+    } else {
+        failed_ = true;
+        push_na();
+    }
+}
+
+void NumberColumnBuilder::push_na() {
+    if (type_ == ColumnType::Int64) {
+        integers.push_back(0);
+    } else {
+        reals.push_back(0);
+    }
+    valid.push_back(false);
+}
+
+size_t NumberColumnBuilder::size() const {
+    return valid.size();
+}
+
+void NumberColumnBuilder::reserve(size_t n) {
+    if (type_ == ColumnType::Int64) {
+        integers.reserve(n);
+    } else {
+        reals.reserve(n);
+    }
+    valid.reserve(n);
+}
+
+void NumberColumnBuilder::merge(ColumnBuilder& other) {
+    auto& tail = dynamic_cast<NumberColumnBuilder&>(other);
+    failed_ |= tail.failed_;
+    if (type_ != tail.type_) {
+        promote();
+        tail.promote();
+    }
+    if (type_ == ColumnType::Int64) {
+        integers.insert(integers.end(), tail.integers.begin(), tail.integers.end());
+        tail.integers.clear();
+    } else {
+        reals.insert(reals.end(), tail.reals.begin(), tail.reals.end());
+        tail.reals.clear();
+    }
+    valid.append(tail.valid);
+    tail.valid.clear();
+}
+
+std::unique_ptr<SeriesUntyped> NumberColumnBuilder::finish() {
+    if (type_ == ColumnType::Int64) {
+        return std::make_unique<Series<int64_t>>(std::move(integers), std::move(valid));
+    }
+    return std::make_unique<Series<double>>(std::move(reals), std::move(valid));
+}
+
+void NumberColumnBuilder::promote() {
+    if (type_ == ColumnType::Double) {
+        return;
+    }
+    reals.reserve(std::max(reals.capacity(), integers.size()));
+    reals.assign(integers.begin(), integers.end());
+    integers = {};
+    type_    = ColumnType::Double;
+}
+
+namespace {
+
+/**
+ * Read a single cell starting at p.
+ *
+ * @param scanner Finds the next structural character of the buffer.
+ * @param scratch Backing storage for quoted cells that contain escaped quotes.
+ * @param cell Receives the cell content without quotes.
+ *
+ * @returns Pointer to the delimiter or line break that ends the cell.
+ */
+const char* read_cell(const char* p, const char* end, char delimiter, StructuralScanner& scanner,
+                      std::string& scratch, std::string_view& cell) {
+    if (p == end || *p != '"') {
+        // A quote in the middle of an unquoted cell is an ordinary character.
+        const char* q = scanner.next(p);
+        while (q < end && *q == '"') {
+            q = scanner.next(q + 1);
+        }
+        cell = std::string_view(p, q - p);
+        return q;
+    }
+    const char* start   = ++p;
+    bool        escaped = false;
+    while (true) {
+        const char* quote = scanner.next(p);
+        while (quote < end && *quote != '"') {
+            quote = scanner.next(quote + 1);
+        }
+        if (quote == end) {
+            throw std::runtime_error("Unterminated quoted cell");
+        }
+        if (quote + 1 < end && quote[1] == '"') {
+            escaped = true;
+            p       = quote + 2;
+            continue;
+        }
+        if (escaped) {
+            scratch.clear();
+            for (const char* c = start; c < quote; ++c) {
+                scratch.push_back(*c);
+                if (*c == '"') {
+                    ++c;
+                }
+            }
+            cell = scratch;
+        } else {
+            cell = std::string_view(start, quote - start);
+        }
+        p = quote + 1;
+        break;
+    }
+    if (p < end && *p != delimiter && *p != '\n' && *p != '\r') {
+        throw std::runtime_error("Unexpected character after closing quote");
+    }
+    return p;
+}
+
+/// Skip a line break at p, if any.
+const char* skip_eol(const char* p, const char* end) {
+    if (p < end && *p == '\r') {
+        ++p;
+    }
+    if (p < end && *p == '\n') {
+        ++p;
+    }
+    return p;
+}
+
+} // namespace
+
+MalformedRecord::MalformedRecord(size_t record)
+    : std::runtime_error("Record " + std::to_string(record + 1) + " has more cells than the header"), record(record) {}
+
+std::vector<std::string> parse_header(std::string_view& buffer, char delimiter) {
+    const char* p   = buffer.data();
+    const char* end = p + buffer.size();
+    if (buffer.starts_with("\xEF\xBB\xBF")) {
+        p += 3;
+    }
+    std::vector<std::string> names;
+    std::string              scratch;
+    StructuralScanner        scanner(buffer, delimiter);
+    while (p < end && *p != '\n' && *p != '\r') {
+        std::string_view cell;
+        p = read_cell(p, end, delimiter, scanner, scratch, cell);
+        names.emplace_back(cell);
+        if (p < end && *p == delimiter) {
+            ++p;
+            if (p == end || *p == '\n' || *p == '\r') {
+                names.emplace_back();
+            }
+        }
+    }
+    p      = skip_eol(p, end);
+    buffer = std::string_view(p, end - p);
+    return names;
+}
+
+namespace {
+
+/**
+ * Tokenize records, see parse_records.
+ *
+ * Without quotes a cell ends at the next delimiter or line break, so read_cell and quote tracking are skipped. The
+ * path is not branchless, every cell still branches on its delimiter or line break and on the width check.
+ *
+ * @param on_cell Called with the column, content and end of every cell, the end is the delimiter or line break.
+ * @param on_record Called with the start and the number of cells of every record after its cells.
+ */
+template <bool Quoted, class OnCell, class OnRecord>
+size_t tokenize_records(std::string_view body, size_t width, char delimiter, size_t limit, OnCell&& on_cell,
+                        OnRecord&& on_record) {
+    const char*       p       = body.data();
+    const char*       end     = p + body.size();
+    size_t            records = 0;
+    std::string       scratch;
+    StructuralScanner scanner(body, delimiter, Quoted);
+    while (p < end && records < limit) {
+        // An empty line of a single column is a record with a missing cell.
+        if (width > 1 && (*p == '\n' || *p == '\r')) {
+            ++p;
+            continue;
+        }
+        const char* start  = p;
+        size_t      column = 0;
+        while (true) {
+            std::string_view cell;
+            if constexpr (Quoted) {
+                p = read_cell(p, end, delimiter, scanner, scratch, cell);
+            } else {
+                const char* q = scanner.next(p);
+                cell          = std::string_view(p, q - p);
+                p             = q;
+            }
+            if (column == width) {
+                throw MalformedRecord(records);
+            }
+            on_cell(column, cell, p);
+            ++column;
+            if (p == end || *p != delimiter) {
+                break;
+            }
+            ++p;
+        }
+        on_record(start, column);
+        p = skip_eol(p, end);
+        ++records;
+    }
+    return records;
+}
+
+template <bool Quoted>
+size_t tokenize_records(std::string_view body, std::span<ColumnBuilder* const> builders, char delimiter,
+                        size_t limit) {
+    return tokenize_records<Quoted>(
+        body, builders.size(), delimiter, limit,
+        [builders](size_t column, std::string_view cell, const char*) {
+            if (builders[column]) {
+                builders[column]->push(cell);
+            }
+        },
+        [builders](const char*, size_t cells) {
+            for (size_t column = cells; column < builders.size(); ++column) {
+                if (builders[column]) {
+                    builders[column]->push_na();
+                }
+            }
+        });
+}
+
+} // namespace
+
+size_t parse_records(std::string_view body, std::span<ColumnBuilder* const> builders, char delimiter, size_t limit) {
+    // A whole chunk is checked with a vectorized memchr, only chunks that have quotes pay for quote handling.
+    // A limited parse may stop early, so scanning all of the body first is not worth it.
+    // An empty body may have no data at all, which memchr must not be given.
+    if (limit == std::numeric_limits<size_t>::max() &&
+        (body.empty() || !std::memchr(body.data(), '"', body.size()))) {
+        return tokenize_records<false>(body, builders, delimiter, limit);
+    }
+    return tokenize_records<true>(body, builders, delimiter, limit);
+}
+
+namespace {
+
+/// Position in a CSV body relative to its cells.
+enum class QuoteState : uint8_t {
+    CellStart, ///< After a delimiter or line break.
+    Unquoted,  ///< Inside an unquoted cell, where a quote is an ordinary character as in read_cell.
+    Quoted,    ///< Inside a quoted cell, line breaks and delimiters are content.
+    Closing,   ///< After a quote of a quoted cell, which closes it unless another quote follows.
+};
+
+/// State after character c, a quote opens a quoted cell only at the start of a cell.
+QuoteState advance(QuoteState state, char c, char delimiter) {
+    if (state == QuoteState::Quoted) {
+        return c == '"' ? QuoteState::Closing : QuoteState::Quoted;
+    }
+    if (c == delimiter || c == '\n' || c == '\r') {
+        return QuoteState::CellStart;
+    }
+    if (c == '"' && state != QuoteState::Unquoted) {
+        return QuoteState::Quoted;
+    }
+    return QuoteState::Unquoted;
+}
+
+/// State after characters that are neither delimiters, quotes nor line breaks.
+QuoteState skip_ordinary(QuoteState state) {
+    return state == QuoteState::Quoted ? QuoteState::Quoted : QuoteState::Unquoted;
+}
+
+/**
+ * Call f with every line break of a CSV body that ends a record, the body starts in state.
+ *
+ * Stops early when f returns false.
+ */
+template <class F>
+void for_each_record_end(std::string_view body, char delimiter, QuoteState state, F&& f) {
+    StructuralScanner scanner(body, delimiter);
+    const char*       p   = body.data();
+    const char*       end = p + body.size();
+    while (p < end) {
+        const char* q = scanner.next(p);
+        if (q == end) {
+            return;
+        }
+        if (q > p) {
+            state = skip_ordinary(state);
+        }
+        if (*q == '\n' && state != QuoteState::Quoted && !f(q)) {
+            return;
+        }
+        state = advance(state, *q, delimiter);
+        p     = q + 1;
+    }
+}
+
+/// State at the end of a slice for every state at its start, the slice is scanned once for all of them.
+std::array<QuoteState, 4> transfer_states(std::string_view slice, char delimiter) {
+    std::array<QuoteState, 4> states = {QuoteState::CellStart, QuoteState::Unquoted, QuoteState::Quoted,
+                                        QuoteState::Closing};
+    StructuralScanner         scanner(slice, delimiter);
+    const char*               p   = slice.data();
+    const char*               end = p + slice.size();
+    while (p < end) {
+        const char* q = scanner.next(p);
+        if (q > p) {
+            for (auto& state : states) {
+                state = skip_ordinary(state);
+            }
+        }
+        if (q == end) {
+            break;
+        }
+        for (auto& state : states) {
+            state = advance(state, *q, delimiter);
+        }
+        p = q + 1;
+    }
+    return states;
+}
+
+/**
+ * Call f with every record of a CSV body, including its line break.
+ *
+ * Stops early when f returns false.
+ */
+template <class F>
+void for_each_record(std::string_view body, char delimiter, F&& f) {
+    const char* start   = body.data();
+    const char* end     = start + body.size();
+    bool        stopped = false;
+    for_each_record_end(body, delimiter, QuoteState::CellStart, [&](const char* eol) {
+        stopped = !f(std::string_view(start, eol + 1 - start));
+        start   = eol + 1;
+        return !stopped;
+    });
+    if (!stopped && start < end) {
+        f(std::string_view(start, end - start));
+    }
+}
+
+/// Whether a record passed by for_each_record is an empty line, which the tokenizer skips if there are several columns.
+bool blank(std::string_view record, size_t width) {
+    return width > 1 && record.find_first_not_of("\r\n") == std::string_view::npos;
+}
+
+} // namespace
+
+std::string_view take_records(std::string_view& body, size_t n, size_t width, char delimiter) {
+    size_t taken   = 0;
+    size_t records = 0;
+    if (n > 0) {
+        for_each_record(body, delimiter, [&](std::string_view record) {
+            taken += record.size();
+            return blank(record, width) || ++records < n;
+        });
+    }
+    std::string_view head = body.substr(0, taken);
+    body.remove_prefix(taken);
+    return head;
+}
+
+std::string_view last_records(std::string_view body, size_t n, size_t width, char delimiter) {
+    if (n == 0) {
+        return body.substr(body.size());
+    }
+    // Starts of the last n records seen so far.
+    std::deque<const char*> starts;
+    for_each_record(body, delimiter, [&](std::string_view record) {
+        if (!blank(record, width)) {
+            starts.push_back(record.data());
+            if (starts.size() > n) {
+                starts.pop_front();
+            }
+        }
+        return true;
+    });
+    return starts.size() < n ? body : body.substr(starts.front() - body.data());
+}
+
+std::string_view reduce_records(std::string_view body, size_t width, const LoadOptions& options,
+                                std::string& storage, char delimiter) {
+    if (options.head) {
+        body = take_records(body, *options.head, width, delimiter);
+    }
+    if (options.tail) {
+        body = last_records(body, *options.tail, width, delimiter);
+    }
+    if (!options.sample) {
+        return body;
+    }
+    if (*options.sample <= 0) {
+        throw std::invalid_argument("Sample has to be positive");
+    }
+    std::mt19937_64 rng(options.seed ? *options.seed : std::random_device{}());
+    auto            keep = [&storage](std::string_view record) {
+        storage.append(record);
+        if (!record.ends_with('\n')) {
+            storage.push_back('\n');
+        }
+    };
+
+    storage.clear();
+    if (*options.sample < 1) {
+        std::bernoulli_distribution coin(*options.sample);
+        for_each_record(body, delimiter, [&](std::string_view record) {
+            if (!blank(record, width) && coin(rng)) {
+                keep(record);
+            }
+            return true;
+        });
+    } else {
+        // Reservoir of views into the body, copied in their original order at the end.
+        size_t                        size = *options.sample;
+        std::vector<std::string_view> reservoir;
+        size_t                        seen = 0;
+        for_each_record(body, delimiter, [&](std::string_view record) {
+            if (blank(record, width)) {
+                return true;
+            }
+            if (reservoir.size() < size) {
+                reservoir.push_back(record);
+            } else if (size_t j = std::uniform_int_distribution<size_t>(0, seen)(rng); j < size) {
+                reservoir[j] = record;
+            }
+            ++seen;
+            return true;
+        });
+        std::sort(reservoir.begin(), reservoir.end(),
+                  [](std::string_view a, std::string_view b) { return a.data() < b.data(); });
+        for (auto record : reservoir) {
+            keep(record);
+        }
+    }
+    return storage;
+}
+
+std::vector<std::string_view> split_records(std::string_view body, size_t parts, size_t threads, char delimiter) {
+    if (parts <= 1 || body.size() < parts) {
+        return {body};
+    }
+    size_t                                 step = body.size() / parts;
+    std::vector<std::array<QuoteState, 4>> transfers(parts);
+    parallel_for(parts, threads, [&](size_t i) {
+        size_t size  = i + 1 == parts ? body.size() - i * step : step;
+        transfers[i] = transfer_states(body.substr(i * step, size), delimiter);
+    });
+
+    std::vector<size_t> starts = {0};
+    QuoteState          state  = QuoteState::CellStart;
+    for (size_t i = 1; i < parts; ++i) {
+        state      = transfers[i - 1][static_cast<size_t>(state)];
+        size_t pos = body.size();
+        for_each_record_end(body.substr(i * step), delimiter, state, [&](const char* eol) {
+            pos = eol - body.data();
+            return false;
+        });
+        if (pos + 1 < body.size() && pos + 1 > starts.back()) {
+            starts.push_back(pos + 1);
+        }
+    }
+
+    std::vector<std::string_view> chunks;
+    chunks.reserve(starts.size());
+    for (size_t i = 0; i < starts.size(); ++i) {
+        size_t end = i + 1 == starts.size() ? body.size() : starts[i + 1];
+        chunks.push_back(body.substr(starts[i], end - starts[i]));
+    }
+    return chunks;
+}
+
+std::vector<std::unique_ptr<ColumnBuilder>> parse_records_parallel(std::string_view body, size_t width,
+                                                                   const BuilderFactory& factory, size_t& records,
+                                                                   const LoadOptions& options, char delimiter) {
+    size_t threads = options.threads ? options.threads : default_threads();
+    size_t parts   = std::clamp<size_t>(body.size() / std::max<size_t>(options.min_chunk_size, 1), 1, threads);
+    auto   chunks  = split_records(body, parts, threads, delimiter);
+
+    std::vector<std::vector<std::unique_ptr<ColumnBuilder>>> fragments(chunks.size());
+    for (auto& builders : fragments) {
+        for (size_t j = 0; j < width; ++j) {
+            builders.push_back(factory(j));
+        }
+    }
+    std::vector<size_t>                counts(chunks.size());
+    std::vector<std::optional<size_t>> malformed(chunks.size());
+    parallel_for(chunks.size(), threads, [&](size_t c) {
+        std::vector<ColumnBuilder*> sinks(width);
+        for (size_t j = 0; j < width; ++j) {
+            sinks[j] = fragments[c][j].get();
+        }
+        try {
+            counts[c] = parse_records(chunks[c], sinks, delimiter);
+        } catch (const MalformedRecord& e) {
+            // Reported once records of earlier chunks are counted.
+            malformed[c] = e.record;
+        }
+    });
+
+    records = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        if (malformed[c]) {
+            throw MalformedRecord(records + *malformed[c]);
+        }
+        records += counts[c];
+    }
+    std::vector<std::unique_ptr<ColumnBuilder>> columns(width);
+    parallel_for(width, threads, [&](size_t j) {
+        auto& head = fragments[0][j];
+        if (head && fragments.size() > 1) {
+            size_t total = 0;
+            for (auto& builders : fragments) {
+                total += builders[j]->size();
+            }
+            head->reserve(total);
+            for (size_t c = 1; c < fragments.size(); ++c) {
+                head->merge(*fragments[c][j]);
+                fragments[c][j].reset();
+            }
+        }
+        columns[j] = std::move(head);
+    });
+    return columns;
+}
+
+std::vector<size_t> select_columns(const std::vector<std::string>& header, const std::vector<std::string>& columns) {
+    std::vector<size_t> selected;
+    if (columns.empty()) {
+        selected.resize(header.size());
+        std::iota(selected.begin(), selected.end(), 0);
+        return selected;
+    }
+    for (const auto& name : columns) {
+        auto it = std::find(header.begin(), header.end(), name);
+        if (it == header.end()) {
+            throw std::invalid_argument("Column `" + name + "` is not in the header");
+        }
+        size_t index = it - header.begin();
+        if (std::find(selected.begin(), selected.end(), index) != selected.end()) {
+            throw std::invalid_argument("Column `" + name + "` is selected twice");
+        }
+        selected.push_back(index);
+    }
+    return selected;
+}
+
+std::vector<ColumnType> infer_types(std::string_view body, const std::vector<std::string>& header,
+                                    std::span<const size_t> selected, const LoadOptions& options, char delimiter) {
+    size_t                  width = header.size();
+    std::vector<ColumnType> types(width, ColumnType::String);
+    std::vector<bool>       keep(width);
+    for (size_t j : selected) {
+        // Declared columns are not scanned.
+        if (auto it = options.column_types.find(header[j]); it != options.column_types.end()) {
+            types[j] = it->second;
+        } else {
+            keep[j] = true;
+        }
+    }
+    if (options.inference == Inference::None || std::find(keep.begin(), keep.end(), true) == keep.end()) {
+        return types;
+    }
+    BuilderFactory factory = [&](size_t j) -> std::unique_ptr<ColumnBuilder> {
+        if (!keep[j]) {
+            return nullptr;
+        }
+        return std::make_unique<TypeScanBuilder>(options.na_for(header[j]));
+    };
+
+    std::vector<std::unique_ptr<ColumnBuilder>> scans;
+    if (options.inference == Inference::Sample) {
+        std::vector<ColumnBuilder*> sinks;
+        for (size_t j = 0; j < width; ++j) {
+            scans.push_back(factory(j));
+            sinks.push_back(scans.back().get());
+        }
+        parse_records(body, sinks, delimiter, options.sample_rows);
+    } else {
+        size_t records;
+        scans = parse_records_parallel(body, width, factory, records, options, delimiter);
+    }
+    for (size_t j : selected) {
+        if (keep[j]) {
+            types[j] = dynamic_cast<TypeScanBuilder&>(*scans[j]).type();
+        }
+    }
+    return types;
+}
+
+namespace {
+
+/// Builder of a selected column of a given type.
+std::unique_ptr<ColumnBuilder> make_builder(ColumnType type, const std::string& name, const LoadOptions& options) {
+    bool declared = options.column_types.contains(name);
+    if (type == ColumnType::String) {
+        return std::make_unique<StringColumnBuilder>(options.na_for(name), declared ? 0 : options.max_categories);
+    }
+    return std::make_unique<NumberColumnBuilder>(type, options.na_for(name), declared);
+}
+
+} // namespace
+
+std::vector<std::unique_ptr<SeriesUntyped>> read_columns(std::string_view body, const std::vector<std::string>& header,
+                                                         std::span<const size_t> selected, size_t& records,
+                                                         const LoadOptions& options, char delimiter) {
+    size_t              width = header.size();
+    auto                types = infer_types(body, header, selected, options, delimiter);
+    std::vector<size_t> slot(width, selected.size());
+    for (size_t k = 0; k < selected.size(); ++k) {
+        slot[selected[k]] = k;
+    }
+    // Builders of columns that are not selected are nullptr, so their cells are skipped while tokenizing.
+    auto builders = parse_records_parallel(
+        body, width,
+        [&](size_t j) -> std::unique_ptr<ColumnBuilder> {
+            if (slot[j] == selected.size()) {
+                return nullptr;
+            }
+            return make_builder(types[j], header[j], options);
+        },
+        records, options, delimiter);
+
+    std::vector<std::unique_ptr<SeriesUntyped>> columns(selected.size());
+    std::vector<size_t>                         reparse;
+    for (size_t k = 0; k < selected.size(); ++k) {
+        auto& builder = builders[selected[k]];
+        auto* numbers = dynamic_cast<NumberColumnBuilder*>(builder.get());
+        if (numbers && numbers->failed()) {
+            reparse.push_back(selected[k]);
+        } else {
+            columns[k] = builder->finish();
+        }
+        builder.reset();
+    }
+    if (!reparse.empty()) {
+        // Only columns that broke the sampled guess are parsed again.
+        builders = parse_records_parallel(
+            body, width,
+            [&](size_t j) -> std::unique_ptr<ColumnBuilder> {
+                if (std::find(reparse.begin(), reparse.end(), j) == reparse.end()) {
+                    return nullptr;
+                }
+                return make_builder(ColumnType::String, header[j], options);
+            },
+            records, options, delimiter);
+        for (size_t j : reparse) {
+            columns[slot[j]] = builders[j]->finish();
+        }
+    }
+    return columns;
+}
+
+namespace {
+
+/**
+ * Read pieces of an input until its header line is complete.
+ *
+ * @param pending Receives content read past the header.
+ */
+std::vector<std::string> read_header(const PieceSource& next, std::string& pending, char delimiter) {
+    std::string_view piece;
+    while (pending.find('\n') == std::string::npos && !(piece = next()).empty()) {
+        pending.append(piece);
+    }
+    std::string_view         body   = pending;
+    std::vector<std::string> header = parse_header(body, delimiter);
+    pending.erase(0, pending.size() - body.size());
+    return header;
+}
+
+/**
+ * Call f with the complete records of every piece of an input, records cut by the end of a piece join the next one.
+ *
+ * @param pending Content read before, e.g. past the header.
+ */
+template <class F>
+void for_each_chunk(const PieceSource& next, std::string& pending, char delimiter, F&& f) {
+    bool end = false;
+    while (!end) {
+        std::string_view piece = next();
+        end                    = piece.empty();
+        pending.append(piece);
+
+        // Records are complete up to the last line break outside of quotes, or the end of the input.
+        size_t complete = end ? pending.size() : 0;
+        if (!end) {
+            for_each_record_end(pending, delimiter, QuoteState::CellStart, [&](const char* eol) {
+                complete = eol + 1 - pending.data();
+                return true;
+            });
+        }
+        if (complete > 0) {
+            f(std::string_view(pending.data(), complete));
+            pending.erase(0, complete);
+        }
+    }
+}
+
+} // namespace
+
+std::vector<std::unique_ptr<SeriesUntyped>> read_pieces(const SourceFactory& open, std::vector<std::string>& header,
+                                                        std::vector<size_t>& selected, size_t& records,
+                                                        const LoadOptions& options, char delimiter) {
+    PieceSource next = open();
+    std::string pending;
+    header   = read_header(next, pending, delimiter);
+    selected = select_columns(header, options.columns);
+
+    size_t              width = header.size();
+    std::vector<bool>   keep(width);
+    std::vector<size_t> slot(width, selected.size());
+    for (size_t k = 0; k < selected.size(); ++k) {
+        keep[selected[k]] = true;
+        slot[selected[k]] = k;
+    }
+    LoadOptions sample = options;
+    if (sample.inference == Inference::Full) {
+        sample.inference = Inference::Sample;
+    }
+
+    std::vector<ColumnType>                     types;
+    std::vector<std::unique_ptr<ColumnBuilder>> builders;
+    records = 0;
+    for_each_chunk(next, pending, delimiter, [&](std::string_view chunk) {
+        if (types.empty()) {
+            types = infer_types(chunk, header, selected, sample, delimiter);
+        }
+        size_t                                      n;
+        std::vector<std::unique_ptr<ColumnBuilder>> part;
+        try {
+            part = parse_records_parallel(
+                chunk, width,
+                [&](size_t j) -> std::unique_ptr<ColumnBuilder> {
+                    return keep[j] ? make_builder(types[j], header[j], options) : nullptr;
+                },
+                n, options, delimiter);
+        } catch (const MalformedRecord& e) {
+            throw MalformedRecord(records + e.record);
+        }
+        records += n;
+        if (builders.empty()) {
+            builders = std::move(part);
+        } else {
+            for (size_t j : selected) {
+                builders[j]->merge(*part[j]);
+            }
+        }
+    });
+    next = {};
+
+    if (builders.empty()) {
+        // No records at all.
+        builders.resize(width);
+        for (size_t j : selected) {
+            builders[j] = make_builder(ColumnType::String, header[j], options);
+        }
+    }
+    std::vector<std::unique_ptr<SeriesUntyped>> columns(selected.size());
+    std::vector<bool>                            reparse(width);
+    for (size_t j : selected) {
+        auto* numbers = dynamic_cast<NumberColumnBuilder*>(builders[j].get());
+        if (numbers && numbers->failed()) {
+            reparse[j] = true;
+        } else {
+            columns[slot[j]] = builders[j]->finish();
+        }
+        builders[j].reset();
+    }
+    if (std::find(reparse.begin(), reparse.end(), true) != reparse.end()) {
+        // Only columns that broke the guess are parsed again, from a new pass over the input. Keeping the text
+        // for them would hold all of the decompressed input in memory.
+        std::vector<std::unique_ptr<ColumnBuilder>> strings;
+        PieceSource                                 again = open();
+        pending.clear();
+        read_header(again, pending, delimiter);
+        for_each_chunk(again, pending, delimiter, [&](std::string_view chunk) {
+            size_t n;
+            auto   part = parse_records_parallel(
+                chunk, width,
+                [&](size_t j) -> std::unique_ptr<ColumnBuilder> {
+                    return reparse[j] ? make_builder(ColumnType::String, header[j], options) : nullptr;
+                },
+                n, options, delimiter);
+            if (strings.empty()) {
+                strings = std::move(part);
+            } else {
+                for (size_t j = 0; j < width; ++j) {
+                    if (reparse[j]) {
+                        strings[j]->merge(*part[j]);
+                    }
+                }
+            }
+        });
+        for (size_t j = 0; j < width; ++j) {
+            if (reparse[j]) {
+                columns[slot[j]] = strings[j]->finish();
+            }
+        }
+    }
+    return columns;
+}
+
+RecordIndex::RecordIndex(std::string_view body, size_t width, const LoadOptions& options, char delimiter)
+    : body(body), width(width) {
+    size_t threads = options.threads ? options.threads : default_threads();
+    size_t parts   = std::clamp<size_t>(body.size() / std::max<size_t>(options.min_chunk_size, 1), 1, threads);
+    auto   chunks  = split_records(body, parts, threads, delimiter);
+
+    std::vector<std::vector<uint64_t>> chunk_rows(chunks.size());
+    std::vector<std::vector<uint32_t>> chunk_ends(chunks.size());
+    std::vector<std::optional<size_t>> malformed(chunks.size());
+    parallel_for(chunks.size(), threads, [&](size_t c) {
+        std::vector<uint64_t> cell_ends(width);
+        auto                  on_cell = [&](size_t column, std::string_view, const char* end) {
+            cell_ends[column] = end - body.data();
+        };
+        auto on_record = [&](const char* start, size_t cells) {
+            uint64_t row = start - body.data();
+            chunk_rows[c].push_back(row);
+            for (size_t j = 0; j < width; ++j) {
+                chunk_ends[c].push_back(j < cells ? static_cast<uint32_t>(cell_ends[j] - row) : missing);
+            }
+        };
+        try {
+            if (!chunks[c].empty() && std::memchr(chunks[c].data(), '"', chunks[c].size())) {
+                tokenize_records<true>(chunks[c], width, delimiter, std::numeric_limits<size_t>::max(), on_cell,
+                                       on_record);
+            } else {
+                tokenize_records<false>(chunks[c], width, delimiter, std::numeric_limits<size_t>::max(), on_cell,
+                                        on_record);
+            }
+        } catch (const MalformedRecord& e) {
+            malformed[c] = e.record;
+        }
+    });
+
+    size_t total = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        if (malformed[c]) {
+            throw MalformedRecord(total + *malformed[c]);
+        }
+        total += chunk_rows[c].size();
+    }
+    rows.reserve(total);
+    ends.reserve(total * width);
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        rows.insert(rows.end(), chunk_rows[c].begin(), chunk_rows[c].end());
+        ends.insert(ends.end(), chunk_ends[c].begin(), chunk_ends[c].end());
+    }
+}
+
+std::optional<std::string_view> RecordIndex::raw(size_t row, size_t column) const {
+    const uint32_t* record = ends.data() + row * width;
+    if (record[column] == missing) {
+        return {};
+    }
+    // A cell starts after the delimiter that ends the previous one.
+    size_t start = column == 0 ? 0 : record[column - 1] + 1;
+    return body.substr(rows[row] + start, record[column] - start);
+}
+
+std::optional<std::string_view> RecordIndex::cell(size_t row, size_t column, std::string& scratch) const {
+    auto text = raw(row, column);
+    if (!text || !text->starts_with('"')) {
+        return text;
+    }
+    std::string_view inner = text->substr(1, text->size() - 2);
+    if (inner.find('"') == std::string_view::npos) {
+        return inner;
+    }
+    scratch.clear();
+    for (size_t i = 0; i < inner.size(); ++i) {
+        scratch.push_back(inner[i]);
+        if (inner[i] == '"') {
+            ++i;
+        }
+    }
+    return std::string_view(scratch);
+}
+
+void RecordIndex::feed(size_t column, size_t first, size_t last, ColumnBuilder& builder) const {
+    std::string scratch;
+    for (size_t row = first; row < last; ++row) {
+        if (auto text = cell(row, column, scratch)) {
+            builder.push(*text);
+        } else {
+            builder.push_na();
+        }
+    }
+}
+
+std::unique_ptr<SeriesUntyped> RecordIndex::read_column(size_t column, const std::string& name,
+                                                        const LoadOptions& options) const {
+    ColumnType type = ColumnType::String;
+    if (auto it = options.column_types.find(name); it != options.column_types.end()) {
+        type = it->second;
+    } else if (options.inference != Inference::None) {
+        TypeScanBuilder scan(options.na_for(name));
+        feed(column, 0, options.inference == Inference::Sample ? std::min(options.sample_rows, size()) : size(), scan);
+        type = scan.type();
+    }
+
+    size_t threads = options.threads ? options.threads : default_threads();
+    auto   build   = [&](ColumnType type) {
+        // Rows are split evenly, every part is built on its own and parts are merged in order.
+        size_t parts = std::clamp<size_t>(size() / (1 << 16), 1, threads);
+        std::vector<std::unique_ptr<ColumnBuilder>> builders(parts);
+        parallel_for(parts, threads, [&](size_t k) {
+            builders[k] = make_builder(type, name, options);
+            feed(column, size() * k / parts, size() * (k + 1) / parts, *builders[k]);
+        });
+        builders[0]->reserve(size());
+        for (size_t k = 1; k < parts; ++k) {
+            builders[0]->merge(*builders[k]);
+        }
+        return std::move(builders[0]);
+    };
+    auto builder = build(type);
+    if (auto* numbers = dynamic_cast<NumberColumnBuilder*>(builder.get()); numbers && numbers->failed()) {
+        builder = build(ColumnType::String);
+    }
+    return builder->finish();
+}
+
+} // namespace Luxora
+
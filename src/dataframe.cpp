@@ -1,54 +1,304 @@
 #include <fstream>
 #include <istream>
+#include <iterator>
+#include <luxora/compression.h>
+#include <luxora/csv.h>
 #include <luxora/dataframe.h>
+#include <luxora/parallel.h>
 #include <luxora/series.h>
 #include <memory>
-#include <rapidcsv.h>
 #include <string>
+#include <typeindex>
 #include <unordered_map>
+#include <utility>
 
 namespace Luxora {
 
+struct DataFrame::LazySource {
+    std::shared_ptr<const void> input;
+    RecordIndex                 index;
+    /// Field of the file that every lazily loaded column comes from.
+    std::vector<size_t> fields;
+    LoadOptions         options;
+};
+
 DataFrame::DataFrame() {}
 DataFrame::DataFrame(std::string filename) {
     load(filename);
 }
 
-void DataFrame::load_from_document(const rapidcsv::Document& document) {
+void DataFrame::load_from_buffer(std::string_view buffer, const LoadOptions& options,
+                                 std::shared_ptr<const void> input) {
+    std::vector<std::string> header = parse_header(buffer);
+    load_records(header, buffer, options, std::move(input));
+}
+
+void DataFrame::load_records(const std::vector<std::string>& header, std::string_view body,
+                             const LoadOptions& options, std::shared_ptr<const void> input) {
     column_indices.clear();
     columns.clear();
-    shape.second = document.GetColumnCount();
+    source.reset();
+    std::vector<size_t> selected = select_columns(header, options.columns);
+    auto                sampled  = std::make_shared<std::string>();
+
+    body = reduce_records(body, header.size(), options, *sampled);
+    if (!options.lazy || !input) {
+        columns = read_columns(body, header, selected, shape.first, options);
+        name_columns(header, selected);
+        return;
+    }
+    if (body.data() == sampled->data()) {
+        input = sampled;
+    }
+    source      = std::make_shared<LazySource>(std::move(input), RecordIndex(body, header.size(), options),
+                                          std::vector<size_t>(selected.begin(), selected.end()), options);
+    shape.first = source->index.size();
+    columns.resize(selected.size());
+    name_columns(header, selected);
+
+    // Declared types are checked by load, as in an eager load, instead of failing on the first access.
+    for (size_t j = 0; j < selected.size(); ++j) {
+        if (options.column_types.contains(column_names[j])) {
+            column(j);
+        }
+    }
+}
+
+SeriesUntyped& DataFrame::column(size_t column_id) const {
+    if (!columns[column_id]) {
+        columns[column_id] = source->index.read_column(source->fields[column_id], column_names[column_id],
+                                                       source->options);
+        if (std::all_of(columns.begin(), columns.end(), [](const auto& series) { return series != nullptr; })) {
+            source.reset();
+        }
+    }
+    return *columns[column_id];
+}
+
+void DataFrame::load_files(const std::vector<std::string>& files, const LoadOptions& options) {
+    // Every file gets a share of the threads. Columns are parsed right away to be joined, but the index of every
+    // file is kept so that a column can be parsed again on its own.
+    size_t      threads      = options.threads ? options.threads : default_threads();
+    LoadOptions file_options = options;
+    file_options.lazy        = true;
+    file_options.threads     = std::max<size_t>(1, threads / files.size());
+
+    std::vector<DataFrame> parts(files.size());
+    parallel_for(files.size(), threads, [&](size_t k) {
+        DataFrame& part = parts[k];
+        part.load(files[k], file_options);
+        for (size_t j = 0; part.source && j < part.shape.second; ++j) {
+            if (!part.columns[j]) {
+                part.columns[j] =
+                    part.source->index.read_column(part.source->fields[j], part.column_names[j], part.source->options);
+            }
+        }
+    });
+    for (size_t k = 1; k < parts.size(); ++k) {
+        if (parts[k].column_names != parts[0].column_names) {
+            throw std::invalid_argument("Columns of " + files[k] + " differ from columns of " + files[0]);
+        }
+    }
+
+    // Types guessed for different files may disagree. A column that is text in some file is parsed again
+    // as text in the others, integers are promoted when some file has doubles. Compressed files have no index
+    // and are parsed again whole.
+    size_t                           width = parts[0].shape.second;
+    LoadOptions                      text  = file_options;
+    std::vector<bool>                reload(files.size());
+    std::vector<std::vector<size_t>> reparse(files.size());
+    for (size_t j = 0; j < width; ++j) {
+        auto is_text = [j](const DataFrame& part) {
+            return part.columns[j]->type() == typeid(std::string) || part.columns[j]->type() == typeid(Categorical);
+        };
+        if (std::any_of(parts.begin(), parts.end(), is_text) && !std::all_of(parts.begin(), parts.end(), is_text)) {
+            text.column_types[parts[0].column_names[j]] = ColumnType::String;
+            for (size_t k = 0; k < parts.size(); ++k) {
+                if (is_text(parts[k])) {
+                    continue;
+                }
+                if (parts[k].source) {
+                    reparse[k].push_back(j);
+                } else {
+                    reload[k] = true;
+                }
+            }
+        }
+    }
+    parallel_for(files.size(), threads, [&](size_t k) {
+        DataFrame& part = parts[k];
+        if (reload[k]) {
+            part.load(files[k], text);
+            return;
+        }
+        for (size_t j : reparse[k]) {
+            part.columns[j] = part.source->index.read_column(part.source->fields[j], part.column_names[j], text);
+        }
+    });
+    for (size_t j = 0; j < width; ++j) {
+        auto is_double = [j](const DataFrame& part) { return part.columns[j]->type() == typeid(double); };
+        if (!std::any_of(parts.begin(), parts.end(), is_double)) {
+            continue;
+        }
+        for (auto& part : parts) {
+            if (part.columns[j]->type() == typeid(int64_t)) {
+                part.columns[j] = std::make_unique<Series<double>>(part.get_column<int64_t>(j)->cast<double>());
+            }
+        }
+    }
+
+    size_t rows = 0;
+    for (const auto& part : parts) {
+        rows += part.shape.first;
+    }
+    *this = std::move(parts[0]);
+    source.reset();
+    for (size_t j = 0; j < width; ++j) {
+        columns[j]->reserve(rows);
+    }
+    for (size_t k = 1; k < parts.size(); ++k) {
+        for (size_t j = 0; j < width; ++j) {
+            columns[j]->append(std::move(*parts[k].columns[j]));
+        }
+    }
+    shape.first = rows;
+}
+
+void DataFrame::load_compressed(const std::string& filename, const LoadOptions& options) {
+    if (options.head || options.tail || options.sample) {
+        // Records are reduced on the whole input.
+        Decompressor input(filename);
+        std::string  buffer;
+        for (auto piece = input.next(); !piece.empty(); piece = input.next()) {
+            buffer.append(piece);
+        }
+        load_from_buffer(buffer, options);
+        return;
+    }
+    column_indices.clear();
+    columns.clear();
+    std::vector<std::string> header;
+    std::vector<size_t>      selected;
+    auto open = [&filename]() -> PieceSource {
+        auto input = std::make_shared<Decompressor>(filename);
+        return [input]() { return input->next(); };
+    };
+    columns = read_pieces(open, header, selected, shape.first, options);
+    name_columns(header, selected);
+}
+
+void DataFrame::name_columns(const std::vector<std::string>& header, std::span<const size_t> selected) {
+    shape.second  = selected.size();
+    column_subset = selected.size() < header.size();
     column_names.resize(shape.second);
     column_indices.reserve(shape.second);
     for (size_t i = 0; i < shape.second; ++i) {
-        column_names[i]                 = document.GetColumnName(i);
+        column_names[i]                 = header[selected[i]];
         column_indices[column_names[i]] = i;
+    }
+}
 
-        Series<std::string> s = Series<std::string>::from_vector(document.GetColumn<std::string>(i));
-        s.identify_na("");
-        columns.push_back(std::make_unique<Series<std::string>>(s));
+void DataFrame::load(std::string filename, const LoadOptions& options) {
+    if (is_pattern(filename)) {
+        load_files(expand_pattern(filename), options);
+        return;
+    }
+    auto file = std::make_shared<MappedFile>(filename);
+    if (detect_compression(file->view()) != Compression::None) {
+        load_compressed(filename, options);
+        return;
     }
-    shape.first = columns[0]->size();
+    load_from_buffer(file->view(), options, file);
+}
+
+void DataFrame::load(std::istream& is, const LoadOptions& options) {
+    auto buffer = std::make_shared<std::string>(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    load_from_buffer(*buffer, options, buffer);
+}
+
+void DataFrame::append(std::string filename, const LoadOptions& options) {
+    DataFrame tail;
+    tail.load(filename, append_options(options));
+    append_rows(std::move(tail));
 }
 
-void DataFrame::load(std::string filename) {
-    rapidcsv::Document document(filename);
-    load_from_document(document);
+void DataFrame::append(std::istream& is, const LoadOptions& options) {
+    DataFrame tail;
+    tail.load(is, append_options(options));
+    append_rows(std::move(tail));
 }
 
-void DataFrame::load(std::istream& is) {
-    rapidcsv::Document document(is);
-    load_from_document(document);
+LoadOptions DataFrame::append_options(LoadOptions options) const {
+    if (shape.second == 0) {
+        return options;
+    }
+    if (column_subset) {
+        options.columns = column_names;
+    }
+    for (size_t j = 0; j < shape.second; ++j) {
+        std::type_index type = column(j).type();
+        if (type == typeid(std::string) || type == typeid(Categorical)) {
+            // Appended cells of a Categorical are encoded into its dictionary.
+            options.column_types[column_names[j]] = ColumnType::String;
+        } else if (type == typeid(float) || type == typeid(double)) {
+            options.column_types[column_names[j]] = ColumnType::Double;
+        } else {
+            options.column_types[column_names[j]] = ColumnType::Int64;
+        }
+    }
+    return options;
 }
 
-std::ostream& DataFrame::write(std::ostream& os, std::string none = "") const {
+void DataFrame::append_rows(DataFrame&& tail) {
+    if (shape.second == 0) {
+        *this = std::move(tail);
+        return;
+    }
+    for (const auto& name : tail.column_names) {
+        if (!column_indices.contains(name)) {
+            throw std::invalid_argument("Appended column `" + name + "` is not in the data frame");
+        }
+    }
+    // Appended columns are parsed and checked before any column grows, so a failure leaves columns as they were.
+    std::vector<SeriesUntyped*> tails(shape.second);
+    for (size_t j = 0; j < shape.second; ++j) {
+        auto it = tail.column_indices.find(column_names[j]);
+        if (it == tail.column_indices.end()) {
+            throw std::invalid_argument("Column `" + column_names[j] + "` is not in the appended file");
+        }
+        tails[j] = &tail.column(it->second);
+        if (!column(j).accepts(tails[j]->type())) {
+            throw std::invalid_argument("Appended column `" + column_names[j] + "` has an incompatible type");
+        }
+    }
     for (size_t j = 0; j < shape.second; ++j) {
+        column(j).append(std::move(*tails[j]));
+    }
+    shape.first += tail.shape.first;
+}
+
+std::ostream& DataFrame::write(std::ostream& os, std::string none = "", bool header) const {
+    for (size_t j = 0; header && j < shape.second; ++j) {
         os << column_names[j] << (j == shape.second - 1 ? '\n' : ',');
     }
+    // Columns that were never accessed are copied from the source as they are, only NA tokens are replaced.
+    std::vector<NaTokens> na(shape.second);
+    for (size_t j = 0; source && j < shape.second; ++j) {
+        if (!columns[j]) {
+            na[j] = source->options.na_for(column_names[j]);
+        }
+    }
+    std::string scratch;
     for (size_t i = 0; i < shape.first; ++i) {
         for (size_t j = 0; j < shape.second; ++j) {
-            std::optional<std::string> cell = (*columns[j]).string_at(i);
-            os << cell.value_or(none) << (j == shape.second - 1 ? '\n' : ',');
+            if (columns[j]) {
+                columns[j]->write_at(os, i, none);
+            } else if (auto cell = source->index.cell(i, source->fields[j], scratch); !cell || na[j].contains(*cell)) {
+                os << none;
+            } else {
+                os << *source->index.raw(i, source->fields[j]);
+            }
+            os << (j == shape.second - 1 ? '\n' : ',');
         }
     }
     return os;
@@ -60,13 +310,68 @@ std::ostream& DataFrame::choose_rows(std::ostream& os, std::vector<size_t> indic
     }
     for (auto i : indices) {
         for (size_t j = 0; j < shape.second; ++j) {
-            std::optional<std::string> cell = (*columns[j]).string_at(i);
-            os << cell.value_or("`None`") << (j == shape.second - 1 ? '\n' : ',');
+            column(j).write_at(os, i, "`None`");
+            os << (j == shape.second - 1 ? '\n' : ',');
         }
     }
     return os;
 }
 
+size_t DataFrame::index_of(const std::string& column_name) const {
+    auto it = column_indices.find(column_name);
+    if (it == column_indices.end()) {
+        throw std::invalid_argument("Column `" + column_name + "` is not in the data frame");
+    }
+    return it->second;
+}
+
+Categorical& DataFrame::categorical_at(std::string column_name) {
+    auto* categories = dynamic_cast<Categorical*>(&column(index_of(column_name)));
+    if (!categories) {
+        throw std::invalid_argument("Column " + column_name + " is not categorical");
+    }
+    return *categories;
+}
+
+std::vector<size_t> DataFrame::rows_equal(std::string column_name, std::string_view value) const {
+    const SeriesUntyped& series = column(index_of(column_name));
+    if (auto* categories = dynamic_cast<const Categorical*>(&series)) {
+        return categories->indices_of(value);
+    }
+    std::vector<size_t> res;
+    for (size_t i = 0; i < series.size(); ++i) {
+        if (series.string_at(i) == value) {
+            res.push_back(i);
+        }
+    }
+    return res;
+}
+
+std::vector<std::pair<std::string, size_t>> DataFrame::value_counts(std::string column_name) const {
+    const SeriesUntyped&                        series = column(index_of(column_name));
+    std::vector<std::pair<std::string, size_t>> res;
+    if (auto* categories = dynamic_cast<const Categorical*>(&series)) {
+        std::vector<size_t> counts = categories->counts();
+        for (size_t k = 0; k < counts.size(); ++k) {
+            if (counts[k]) {
+                res.emplace_back(categories->categories()[k], counts[k]);
+            }
+        }
+        return res;
+    }
+    CodeMap index;
+    for (size_t i = 0; i < series.size(); ++i) {
+        if (std::optional<std::string> cell = series.string_at(i)) {
+            auto [it, inserted] = index.try_emplace(*cell, res.size());
+            if (inserted) {
+                res.emplace_back(*cell, 0);
+            }
+            ++res[it->second].second;
+        }
+    }
+    return res;
+}
+
 void DataFrame::save(std::string filename) const {
     std::ofstream file(filename);
     save(file);
@@ -82,8 +387,8 @@ std::ostream& operator<<(std::ostream& out, const DataFrame& df) {
 }
 
 void DataFrame::fill_na(std::string column_name, Strategy strategy) {
-    size_t          column_id = column_indices[column_name];
-    std::type_index ti        = columns[column_id]->type();
+    size_t          column_id = index_of(column_name);
+    std::type_index ti        = column(column_id).type();
     // clang-format off
 		#define support2(type)                                                                                                 \
 			else if (ti == typeid(type)) {                                                                                     \
@@ -93,6 +398,7 @@ void DataFrame::fill_na(std::string column_name, Strategy strategy) {
 		if constexpr (false) {} 
 			support2(int) 
 			support2(long long)
+			support2(int64_t)
 			support2(float)
 			support2(double)
 			support2(size_t)
@@ -0,0 +1,780 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <luxora/simd.h>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LUXORA_X86 1
+#include <immintrin.h>
+#define LUXORA_SSE42 __attribute__((target("sse4.2")))
+#define LUXORA_AVX2 __attribute__((target("avx2")))
+#define LUXORA_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace Luxora {
+
+namespace {
+
+StructuralMasks scan_block_scalar(const char* block, char delimiter) {
+    StructuralMasks masks;
+    for (size_t i = 0; i < scan_block_size; ++i) {
+        uint64_t bit = uint64_t(1) << i;
+        char     c   = block[i];
+        if (c == delimiter) {
+            masks.delimiter |= bit;
+        } else if (c == '"') {
+            masks.quote |= bit;
+        } else if (c == '\n' || c == '\r') {
+            masks.newline |= bit;
+        }
+    }
+    return masks;
+}
+
+#ifdef LUXORA_X86
+__attribute__((target("sse4.2"))) StructuralMasks scan_block_sse42(const char* block, char delimiter) {
+    const __m128i   delimiters = _mm_set1_epi8(delimiter);
+    const __m128i   quotes     = _mm_set1_epi8('"');
+    const __m128i   lfs        = _mm_set1_epi8('\n');
+    const __m128i   crs        = _mm_set1_epi8('\r');
+    StructuralMasks masks;
+    for (size_t i = 0; i < scan_block_size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        masks.delimiter |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, delimiters)))) << i;
+        masks.quote |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quotes)))) << i;
+        __m128i newline = _mm_or_si128(_mm_cmpeq_epi8(bytes, lfs), _mm_cmpeq_epi8(bytes, crs));
+        masks.newline |= uint64_t(uint16_t(_mm_movemask_epi8(newline))) << i;
+    }
+    return masks;
+}
+
+__attribute__((target("avx2"))) StructuralMasks scan_block_avx2(const char* block, char delimiter) {
+    const __m256i   delimiters = _mm256_set1_epi8(delimiter);
+    const __m256i   quotes     = _mm256_set1_epi8('"');
+    const __m256i   lfs        = _mm256_set1_epi8('\n');
+    const __m256i   crs        = _mm256_set1_epi8('\r');
+    StructuralMasks masks;
+    for (size_t i = 0; i < scan_block_size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        masks.delimiter |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, delimiters)))) << i;
+        masks.quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quotes)))) << i;
+        __m256i newline = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, lfs), _mm256_cmpeq_epi8(bytes, crs));
+        masks.newline |= uint64_t(uint32_t(_mm256_movemask_epi8(newline))) << i;
+    }
+    return masks;
+}
+#endif
+
+/// Combine the lanes of vector accumulators into res.
+template <typename T>
+void fold(Aggregates<T>& res, size_t lanes, const SumType<T>* sums, const T* mins, const T* maxs) {
+    for (size_t i = 0; i < lanes; ++i) {
+        res.merge({0, sums[i], mins[i], maxs[i]});
+    }
+}
+
+template <typename T>
+Aggregates<T> aggregate_scalar(const T* values, const uint64_t* validity, size_t n) {
+    Aggregates<T> res;
+    for (size_t i = 0; i < n; ++i) {
+        bool valid = validity[i / 64] >> (i % 64) & 1;
+        res.count += valid;
+        res.sum += values[i];
+        res.min = std::min(res.min, valid ? values[i] : res.min);
+        res.max = std::max(res.max, valid ? values[i] : res.max);
+    }
+    return res;
+}
+
+template <typename T>
+SumType<T> squared_deviations_scalar(const T* values, const uint64_t* validity, size_t n, SumType<T> mean) {
+    SumType<T> res = 0;
+    for (size_t i = 0; i < n; ++i) {
+        SumType<T> d = SumType<T>(values[i]) - mean;
+        res += (validity[i / 64] >> (i % 64) & 1) ? d * d : SumType<T>(0);
+    }
+    return res;
+}
+
+#ifdef LUXORA_X86
+/*
+ * Lane-wise operations of every instruction set, kernels are written once per instruction set on top of them.
+ * Masks select the lanes whose validity bit is set: a vector with all bits of those lanes set for SSE and AVX2,
+ * a mask register for AVX-512. Integers of 64 bits have no min or max before AVX-512, they are emulated with
+ * comparisons. Integers are summed and squared as doubles, widen converts their lanes.
+ *
+ * Integers of 64 bits have no conversion to double before AVX-512DQ. Their halves are placed in the mantissas of
+ * large powers of two instead: the low half in 2^52 + lo, the high half in 2^84 + hi * 2^32, with 2^63 added to a
+ * signed hi to make it unsigned. Subtracting the powers of two and adding both leaves hi * 2^32 + lo, rounded once.
+ */
+
+/// Bits of 2^52, 2^84 + 2^63 and 2^84 + 2^63 + 2^52 for signed or 2^84 and 2^84 + 2^52 for unsigned integers.
+template <typename T>
+struct WidenMagic {
+    static constexpr int64_t low  = 0x4330000000000000;
+    static constexpr int64_t high = std::is_signed_v<T> ? 0x4530000080000000 : 0x4530000000000000;
+    static constexpr int64_t all  = std::is_signed_v<T> ? 0x4530000080100000 : 0x4530000000100000;
+};
+
+/// Vector register of Bytes bytes holding values of type T.
+template <typename T, size_t Bytes>
+struct Register;
+
+template <typename T>
+struct Register<T, 16> {
+    using type = __m128i;
+};
+template <>
+struct Register<float, 16> {
+    using type = __m128;
+};
+template <>
+struct Register<double, 16> {
+    using type = __m128d;
+};
+template <typename T>
+struct Register<T, 32> {
+    using type = __m256i;
+};
+template <>
+struct Register<float, 32> {
+    using type = __m256;
+};
+template <>
+struct Register<double, 32> {
+    using type = __m256d;
+};
+template <typename T>
+struct Register<T, 64> {
+    using type = __m512i;
+};
+template <>
+struct Register<float, 64> {
+    using type = __m512;
+};
+template <>
+struct Register<double, 64> {
+    using type = __m512d;
+};
+
+template <typename T>
+struct Sse42 {
+    using V = typename Register<T, 16>::type;
+    using M = V;
+    /// Operations that values are summed with, see SumType.
+    using Wide = Sse42<SumType<T>>;
+
+    static constexpr size_t lanes = 16 / sizeof(T);
+    /// Vectors of Wide that widen returns.
+    static constexpr size_t parts = sizeof(SumType<T>) / sizeof(T);
+
+    LUXORA_SSE42 static V load(const T* p) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_loadu_ps(p);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_loadu_pd(p);
+        } else {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        }
+    }
+    LUXORA_SSE42 static void store(T* p, V x) {
+        if constexpr (std::is_same_v<T, float>) {
+            _mm_storeu_ps(p, x);
+        } else if constexpr (std::is_same_v<T, double>) {
+            _mm_storeu_pd(p, x);
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+        }
+    }
+    LUXORA_SSE42 static V set1(T x) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_set1_ps(x);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_set1_pd(x);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm_set1_epi32(x);
+        } else {
+            return _mm_set1_epi64x(x);
+        }
+    }
+    /// Lanes of the lowest bits.
+    LUXORA_SSE42 static M mask(uint64_t bits) {
+        __m128i m;
+        if constexpr (sizeof(T) == 4) {
+            const __m128i lane = _mm_setr_epi32(1, 2, 4, 8);
+            m                  = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lane), lane);
+        } else {
+            const __m128i lane = _mm_set_epi64x(2, 1);
+            m                  = _mm_cmpeq_epi64(_mm_and_si128(_mm_set1_epi64x(bits), lane), lane);
+        }
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_castsi128_ps(m);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_castsi128_pd(m);
+        } else {
+            return m;
+        }
+    }
+    /// Lanes of b where m is set, of a elsewhere.
+    LUXORA_SSE42 static V blend(V a, V b, M m) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_blendv_ps(a, b, m);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_blendv_pd(a, b, m);
+        } else {
+            return _mm_blendv_epi8(a, b, m);
+        }
+    }
+    LUXORA_SSE42 static V add(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_add_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_add_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm_add_epi32(a, b);
+        } else {
+            return _mm_add_epi64(a, b);
+        }
+    }
+    LUXORA_SSE42 static V sub(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_sub_ps(a, b);
+        } else {
+            return _mm_sub_pd(a, b);
+        }
+    }
+    LUXORA_SSE42 static V square(V a) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_mul_ps(a, a);
+        } else {
+            return _mm_mul_pd(a, a);
+        }
+    }
+    /// Lanes of a as SumType<T>, in order.
+    template <typename W>
+    LUXORA_SSE42 static void widen(V a, W* parts) {
+        if constexpr (std::is_floating_point_v<T>) {
+            parts[0] = a;
+        } else if constexpr (sizeof(T) == 4) {
+            parts[0] = _mm_cvtepi32_pd(a);
+            parts[1] = _mm_cvtepi32_pd(_mm_unpackhi_epi64(a, a));
+        } else {
+            __m128i lo = _mm_blend_epi16(_mm_set1_epi64x(WidenMagic<T>::low), a, 0b00110011);
+            __m128i hi = _mm_xor_si128(_mm_srli_epi64(a, 32), _mm_set1_epi64x(WidenMagic<T>::high));
+            __m128d hi_dbl =
+                _mm_sub_pd(_mm_castsi128_pd(hi), _mm_castsi128_pd(_mm_set1_epi64x(WidenMagic<T>::all)));
+            parts[0] = _mm_add_pd(hi_dbl, _mm_castsi128_pd(lo));
+        }
+    }
+    /// Lanes where a > b.
+    LUXORA_SSE42 static __m128i greater(V a, V b) {
+        if constexpr (std::is_same_v<T, int64_t>) {
+            return _mm_cmpgt_epi64(a, b);
+        } else {
+            const __m128i sign = _mm_set1_epi64x(int64_t(1) << 63);
+            return _mm_cmpgt_epi64(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+        }
+    }
+    /// Lane-wise minimum, lanes of b where a is NaN.
+    LUXORA_SSE42 static V min(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_min_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_min_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm_min_epi32(a, b);
+        } else {
+            return _mm_blendv_epi8(a, b, greater(a, b));
+        }
+    }
+    /// Lane-wise maximum, lanes of b where a is NaN.
+    LUXORA_SSE42 static V max(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm_max_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm_max_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm_max_epi32(a, b);
+        } else {
+            return _mm_blendv_epi8(a, b, greater(b, a));
+        }
+    }
+};
+
+template <typename T>
+struct Avx2 {
+    using V    = typename Register<T, 32>::type;
+    using M    = V;
+    using Wide = Avx2<SumType<T>>;
+
+    static constexpr size_t lanes = 32 / sizeof(T);
+    static constexpr size_t parts = sizeof(SumType<T>) / sizeof(T);
+
+    LUXORA_AVX2 static V load(const T* p) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_loadu_ps(p);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm256_loadu_pd(p);
+        } else {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        }
+    }
+    LUXORA_AVX2 static void store(T* p, V x) {
+        if constexpr (std::is_same_v<T, float>) {
+            _mm256_storeu_ps(p, x);
+        } else if constexpr (std::is_same_v<T, double>) {
+            _mm256_storeu_pd(p, x);
+        } else {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x);
+        }
+    }
+    LUXORA_AVX2 static V set1(T x) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_set1_ps(x);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm256_set1_pd(x);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm256_set1_epi32(x);
+        } else {
+            return _mm256_set1_epi64x(x);
+        }
+    }
+    LUXORA_AVX2 static M mask(uint64_t bits) {
+        __m256i m;
+        if constexpr (sizeof(T) == 4) {
+            const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+            m                  = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), lane), lane);
+        } else {
+            const __m256i lane = _mm256_setr_epi64x(1, 2, 4, 8);
+            m                  = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(bits), lane), lane);
+        }
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_castsi256_ps(m);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm256_castsi256_pd(m);
+        } else {
+            return m;
+        }
+    }
+    LUXORA_AVX2 static V blend(V a, V b, M m) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_blendv_ps(a, b, m);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm256_blendv_pd(a, b, m);
+        } else {
+            return _mm256_blendv_epi8(a, b, m);
+        }
+    }
+    LUXORA_AVX2 static V add(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_add_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm256_add_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm256_add_epi32(a, b);
+        } else {
+            return _mm256_add_epi64(a, b);
+        }
+    }
+    LUXORA_AVX2 static V sub(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_sub_ps(a, b);
+        } else {
+            return _mm256_sub_pd(a, b);
+        }
+    }
+    LUXORA_AVX2 static V square(V a) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_mul_ps(a, a);
+        } else {
+            return _mm256_mul_pd(a, a);
+        }
+    }
+    template <typename W>
+    LUXORA_AVX2 static void widen(V a, W* parts) {
+        if constexpr (std::is_floating_point_v<T>) {
+            parts[0] = a;
+        } else if constexpr (sizeof(T) == 4) {
+            parts[0] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(a));
+            parts[1] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1));
+        } else {
+            __m256i lo = _mm256_blend_epi32(_mm256_set1_epi64x(WidenMagic<T>::low), a, 0b01010101);
+            __m256i hi = _mm256_xor_si256(_mm256_srli_epi64(a, 32), _mm256_set1_epi64x(WidenMagic<T>::high));
+            __m256d hi_dbl =
+                _mm256_sub_pd(_mm256_castsi256_pd(hi), _mm256_castsi256_pd(_mm256_set1_epi64x(WidenMagic<T>::all)));
+            parts[0] = _mm256_add_pd(hi_dbl, _mm256_castsi256_pd(lo));
+        }
+    }
+    LUXORA_AVX2 static __m256i greater(V a, V b) {
+        if constexpr (std::is_same_v<T, int64_t>) {
+            return _mm256_cmpgt_epi64(a, b);
+        } else {
+            const __m256i sign = _mm256_set1_epi64x(int64_t(1) << 63);
+            return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+        }
+    }
+    LUXORA_AVX2 static V min(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_min_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm256_min_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm256_min_epi32(a, b);
+        } else {
+            return _mm256_blendv_epi8(a, b, greater(a, b));
+        }
+    }
+    LUXORA_AVX2 static V max(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm256_max_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm256_max_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm256_max_epi32(a, b);
+        } else {
+            return _mm256_blendv_epi8(a, b, greater(b, a));
+        }
+    }
+};
+
+template <typename T>
+struct Avx512 {
+    using V    = typename Register<T, 64>::type;
+    using M    = std::conditional_t<sizeof(T) == 4, __mmask16, __mmask8>;
+    using Wide = Avx512<SumType<T>>;
+
+    static constexpr size_t lanes = 64 / sizeof(T);
+    static constexpr size_t parts = sizeof(SumType<T>) / sizeof(T);
+
+    LUXORA_AVX512 static V load(const T* p) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_loadu_ps(p);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm512_loadu_pd(p);
+        } else {
+            return _mm512_loadu_si512(p);
+        }
+    }
+    LUXORA_AVX512 static void store(T* p, V x) {
+        if constexpr (std::is_same_v<T, float>) {
+            _mm512_storeu_ps(p, x);
+        } else if constexpr (std::is_same_v<T, double>) {
+            _mm512_storeu_pd(p, x);
+        } else {
+            _mm512_storeu_si512(p, x);
+        }
+    }
+    LUXORA_AVX512 static V set1(T x) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_set1_ps(x);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm512_set1_pd(x);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm512_set1_epi32(x);
+        } else {
+            return _mm512_set1_epi64(x);
+        }
+    }
+    /// Validity bits are a mask register as they are.
+    static M mask(uint64_t bits) {
+        return M(bits);
+    }
+    LUXORA_AVX512 static V blend(V a, V b, M m) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_mask_blend_ps(m, a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm512_mask_blend_pd(m, a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm512_mask_blend_epi32(m, a, b);
+        } else {
+            return _mm512_mask_blend_epi64(m, a, b);
+        }
+    }
+    LUXORA_AVX512 static V add(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_add_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm512_add_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm512_add_epi32(a, b);
+        } else {
+            return _mm512_add_epi64(a, b);
+        }
+    }
+    LUXORA_AVX512 static V sub(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_sub_ps(a, b);
+        } else {
+            return _mm512_sub_pd(a, b);
+        }
+    }
+    LUXORA_AVX512 static V square(V a) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_mul_ps(a, a);
+        } else {
+            return _mm512_mul_pd(a, a);
+        }
+    }
+    template <typename W>
+    LUXORA_AVX512 static void widen(V a, W* parts) {
+        if constexpr (std::is_floating_point_v<T>) {
+            parts[0] = a;
+        } else if constexpr (sizeof(T) == 4) {
+            parts[0] = _mm512_cvtepi32_pd(_mm512_castsi512_si256(a));
+            parts[1] = _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(a, 1));
+        } else {
+            __m512i lo = _mm512_mask_blend_epi32(0x5555, _mm512_set1_epi64(WidenMagic<T>::low), a);
+            __m512i hi = _mm512_xor_si512(_mm512_srli_epi64(a, 32), _mm512_set1_epi64(WidenMagic<T>::high));
+            __m512d hi_dbl =
+                _mm512_sub_pd(_mm512_castsi512_pd(hi), _mm512_castsi512_pd(_mm512_set1_epi64(WidenMagic<T>::all)));
+            parts[0] = _mm512_add_pd(hi_dbl, _mm512_castsi512_pd(lo));
+        }
+    }
+    LUXORA_AVX512 static V min(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_min_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm512_min_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm512_min_epi32(a, b);
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return _mm512_min_epi64(a, b);
+        } else {
+            return _mm512_min_epu64(a, b);
+        }
+    }
+    LUXORA_AVX512 static V max(V a, V b) {
+        if constexpr (std::is_same_v<T, float>) {
+            return _mm512_max_ps(a, b);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return _mm512_max_pd(a, b);
+        } else if constexpr (sizeof(T) == 4) {
+            return _mm512_max_epi32(a, b);
+        } else if constexpr (std::is_same_v<T, int64_t>) {
+            return _mm512_max_epi64(a, b);
+        } else {
+            return _mm512_max_epu64(a, b);
+        }
+    }
+};
+
+// Kernels take 64 values per validity word, the rest is left to the scalar kernel. Missing values are added
+// to the sum as they are since they hold 0, min and max see the identity in their place. Sums and squared
+// deviations are taken in vectors of Ops::Wide, a vector of 32 bit integers widens to two of them.
+
+#define LUXORA_AGGREGATE_BODY(Ops)                                                                                     \
+    using V = typename Ops::V;                                                                                         \
+    using W = typename Ops::Wide;                                                                                      \
+    typename W::V sum[Ops::parts];                                                                                     \
+    V             min       = Ops::set1(std::numeric_limits<T>::max());                                                \
+    V             max       = Ops::set1(std::numeric_limits<T>::lowest());                                             \
+    const V       min_empty = min;                                                                                     \
+    const V       max_empty = max;                                                                                     \
+    size_t        words     = n / 64;                                                                                  \
+    Aggregates<T> res       = aggregate_scalar(values + 64 * words, validity + words, n % 64);                         \
+    std::fill(sum, sum + Ops::parts, W::set1(0));                                                                      \
+    for (size_t k = 0; k < words; ++k) {                                                                               \
+        uint64_t bits = validity[k];                                                                                   \
+        res.count += std::popcount(bits);                                                                              \
+        for (const T* p = values + 64 * k; p < values + 64 * (k + 1); p += Ops::lanes, bits >>= Ops::lanes) {          \
+            V             x = Ops::load(p);                                                                            \
+            auto          m = Ops::mask(bits);                                                                         \
+            typename W::V wide[Ops::parts];                                                                            \
+            Ops::widen(x, wide);                                                                                       \
+            for (size_t h = 0; h < Ops::parts; ++h) {                                                                  \
+                sum[h] = W::add(sum[h], wide[h]);                                                                      \
+            }                                                                                                          \
+            min = Ops::min(Ops::blend(min_empty, x, m), min);                                                          \
+            max = Ops::max(Ops::blend(max_empty, x, m), max);                                                          \
+        }                                                                                                              \
+    }                                                                                                                  \
+    SumType<T> sums[Ops::lanes];                                                                                       \
+    T          mins[Ops::lanes], maxs[Ops::lanes];                                                                     \
+    for (size_t h = 0; h < Ops::parts; ++h) {                                                                          \
+        W::store(sums + h * W::lanes, sum[h]);                                                                         \
+    }                                                                                                                  \
+    Ops::store(mins, min);                                                                                             \
+    Ops::store(maxs, max);                                                                                             \
+    fold(res, Ops::lanes, sums, mins, maxs);                                                                           \
+    return res;
+
+#define LUXORA_SQUARED_DEVIATIONS_BODY(Ops)                                                                            \
+    using W = typename Ops::Wide;                                                                                      \
+    const typename W::V zero   = W::set1(0);                                                                           \
+    const typename W::V center = W::set1(mean);                                                                        \
+    typename W::V       acc    = zero;                                                                                 \
+    size_t              words  = n / 64;                                                                               \
+    SumType<T>          res    = squared_deviations_scalar(values + 64 * words, validity + words, n % 64, mean);       \
+    for (size_t k = 0; k < words; ++k) {                                                                               \
+        uint64_t bits = validity[k];                                                                                   \
+        for (const T* p = values + 64 * k; p < values + 64 * (k + 1); p += Ops::lanes, bits >>= Ops::lanes) {          \
+            typename W::V wide[Ops::parts];                                                                            \
+            Ops::widen(Ops::load(p), wide);                                                                            \
+            for (size_t h = 0; h < Ops::parts; ++h) {                                                                  \
+                typename W::V d = W::sub(wide[h], center);                                                             \
+                acc             = W::add(acc, W::blend(zero, W::square(d), W::mask(bits >> (h * W::lanes))));          \
+            }                                                                                                          \
+        }                                                                                                              \
+    }                                                                                                                  \
+    SumType<T> lanes[W::lanes];                                                                                        \
+    W::store(lanes, acc);                                                                                              \
+    for (SumType<T> x : lanes) {                                                                                       \
+        res += x;                                                                                                      \
+    }                                                                                                                  \
+    return res;
+
+template <typename T>
+LUXORA_SSE42 Aggregates<T> aggregate_sse42(const T* values, const uint64_t* validity, size_t n) {
+    LUXORA_AGGREGATE_BODY(Sse42<T>)
+}
+
+template <typename T>
+LUXORA_AVX2 Aggregates<T> aggregate_avx2(const T* values, const uint64_t* validity, size_t n) {
+    LUXORA_AGGREGATE_BODY(Avx2<T>)
+}
+
+template <typename T>
+LUXORA_AVX512 Aggregates<T> aggregate_avx512(const T* values, const uint64_t* validity, size_t n) {
+    LUXORA_AGGREGATE_BODY(Avx512<T>)
+}
+
+template <typename T>
+LUXORA_SSE42 SumType<T> squared_deviations_sse42(const T* values, const uint64_t* validity, size_t n,
+                                                 SumType<T> mean) {
+    LUXORA_SQUARED_DEVIATIONS_BODY(Sse42<T>)
+}
+
+template <typename T>
+LUXORA_AVX2 SumType<T> squared_deviations_avx2(const T* values, const uint64_t* validity, size_t n,
+                                               SumType<T> mean) {
+    LUXORA_SQUARED_DEVIATIONS_BODY(Avx2<T>)
+}
+
+template <typename T>
+LUXORA_AVX512 SumType<T> squared_deviations_avx512(const T* values, const uint64_t* validity, size_t n,
+                                                   SumType<T> mean) {
+    LUXORA_SQUARED_DEVIATIONS_BODY(Avx512<T>)
+}
+
+#undef LUXORA_AGGREGATE_BODY
+#undef LUXORA_SQUARED_DEVIATIONS_BODY
+#endif
+
+SimdLevel detect_simd_level() {
+#ifdef LUXORA_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return SimdLevel::SSE42;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+} // namespace
+
+SimdLevel simd_level() {
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+StructuralMasks scan_block(const char* block, char delimiter, SimdLevel level) {
+    switch (level) {
+#ifdef LUXORA_X86
+    case SimdLevel::AVX512:
+    case SimdLevel::AVX2:
+        return scan_block_avx2(block, delimiter);
+    case SimdLevel::SSE42:
+        return scan_block_sse42(block, delimiter);
+#endif
+    default:
+        return scan_block_scalar(block, delimiter);
+    }
+}
+
+template <Reducible T>
+Aggregates<T> aggregate(const T* values, const uint64_t* validity, size_t n, SimdLevel level) {
+    switch (level) {
+#ifdef LUXORA_X86
+    case SimdLevel::AVX512:
+        return aggregate_avx512(values, validity, n);
+    case SimdLevel::AVX2:
+        return aggregate_avx2(values, validity, n);
+    case SimdLevel::SSE42:
+        return aggregate_sse42(values, validity, n);
+#endif
+    default:
+        return aggregate_scalar(values, validity, n);
+    }
+}
+
+template <Reducible T>
+SumType<T> squared_deviations(const T* values, const uint64_t* validity, size_t n, SumType<T> mean,
+                              SimdLevel level) {
+    switch (level) {
+#ifdef LUXORA_X86
+    case SimdLevel::AVX512:
+        return squared_deviations_avx512(values, validity, n, mean);
+    case SimdLevel::AVX2:
+        return squared_deviations_avx2(values, validity, n, mean);
+    case SimdLevel::SSE42:
+        return squared_deviations_sse42(values, validity, n, mean);
+#endif
+    default:
+        return squared_deviations_scalar(values, validity, n, mean);
+    }
+}
+
+#define LUXORA_INSTANTIATE(T)                                                                                          \
+    template Aggregates<T> aggregate(const T*, const uint64_t*, size_t, SimdLevel);                                    \
+    template SumType<T>    squared_deviations(const T*, const uint64_t*, size_t, SumType<T>, SimdLevel);
+LUXORA_INSTANTIATE(float)
+LUXORA_INSTANTIATE(double)
+LUXORA_INSTANTIATE(int32_t)
+LUXORA_INSTANTIATE(int64_t)
+LUXORA_INSTANTIATE(size_t)
+#undef LUXORA_INSTANTIATE
+
+StructuralScanner::StructuralScanner(std::string_view buffer, char delimiter, bool quotes, SimdLevel level)
+    : end(buffer.data() + buffer.size()), delimiter(delimiter), level(level), quotes(quotes) {}
+
+const char* StructuralScanner::next(const char* p) {
+    if (p >= end) {
+        return end;
+    }
+    if (block && p >= block && p < block + scan_block_size) {
+        mask &= ~uint64_t(0) << (p - block);
+    } else {
+        load(p);
+    }
+    while (!mask) {
+        if (end - block <= static_cast<ptrdiff_t>(scan_block_size)) {
+            return end;
+        }
+        load(block + scan_block_size);
+    }
+    return block + std::countr_zero(mask);
+}
+
+void StructuralScanner::load(const char* p) {
+    block = p;
+    if (end - p >= static_cast<ptrdiff_t>(scan_block_size)) {
+        mask = select(scan_block(p, delimiter, level));
+        return;
+    }
+    // The tail is padded with zeros, so bits past the end of the buffer stay clear.
+    char padded[scan_block_size] = {};
+    std::memcpy(padded, p, end - p);
+    mask = select(scan_block(padded, delimiter, level));
+    if (delimiter == '\0') {
+        mask &= (uint64_t(1) << (end - p)) - 1;
+    }
+}
+
+} // namespace Luxora
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <cmath>
+#include <luxora/sketch.h>
+#include <stdexcept>
+#include <utility>
+
+namespace Luxora {
+
+QuantileSketch::QuantileSketch(size_t k) : k(std::max<size_t>(k, 8)) {
+    grow();
+}
+
+void QuantileSketch::add(double x) {
+    levels[0].push_back(x);
+    ++n;
+    if (++retained >= limit) {
+        compress();
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    while (levels.size() < other.levels.size()) {
+        grow();
+    }
+    for (size_t h = 0; h < other.levels.size(); ++h) {
+        levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+    }
+    n += other.n;
+    retained += other.retained;
+    compress();
+}
+
+double QuantileSketch::quantile(float q) const {
+    return quantiles(std::span(&q, 1))[0];
+}
+
+std::vector<double> QuantileSketch::quantiles(std::span<const float> qs) const {
+    if (n == 0) {
+        throw std::logic_error("Not enough non missing values");
+    }
+    std::vector<std::pair<double, uint64_t>> weighted;
+    weighted.reserve(retained);
+    for (size_t h = 0; h < levels.size(); ++h) {
+        for (double x : levels[h]) {
+            weighted.emplace_back(x, uint64_t(1) << h);
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+    // Weights of retained values add up to n, a rank falls on the value whose cumulative weight passes it.
+    std::vector<uint64_t> cumulative(weighted.size());
+    uint64_t              total = 0;
+    for (size_t i = 0; i < weighted.size(); ++i) {
+        total += weighted[i].second;
+        cumulative[i] = total;
+    }
+    std::vector<double> res(qs.size());
+    for (size_t i = 0; i < qs.size(); ++i) {
+        uint64_t rank = std::min<uint64_t>(qs[i] * total, total - 1);
+        size_t   at   = std::upper_bound(cumulative.begin(), cumulative.end(), rank) - cumulative.begin();
+        res[i]        = weighted[at].first;
+    }
+    return res;
+}
+
+void QuantileSketch::grow() {
+    levels.emplace_back();
+    // Levels shrink by 2/3 going down from the top one, which holds k values. Small levels would be compacted
+    // after every few values, so no level holds fewer than 8.
+    capacities.resize(levels.size());
+    limit = 0;
+    for (size_t h = 0; h < levels.size(); ++h) {
+        size_t depth  = levels.size() - h - 1;
+        capacities[h] = std::max<size_t>(8, std::ceil(k * std::pow(2.0 / 3.0, depth)));
+        limit += capacities[h];
+    }
+}
+
+void QuantileSketch::compress() {
+    while (retained >= limit) {
+        // Some level is full while more values are kept than all levels hold.
+        size_t h = 0;
+        while (levels[h].size() < capacities[h]) {
+            ++h;
+        }
+        if (h + 1 == levels.size()) {
+            grow();
+        }
+        // A random value of every sorted pair moves up with twice the weight, the smallest stays if one is left.
+        std::vector<double>& level = levels[h];
+        std::sort(level.begin(), level.end());
+        size_t odd = level.size() % 2;
+        for (size_t i = odd + coin() % 2; i < level.size(); i += 2) {
+            levels[h + 1].push_back(level[i]);
+        }
+        retained -= level.size() - odd - (level.size() - odd) / 2;
+        level.resize(odd);
+    }
+}
+
+} // namespace Luxora
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cmath>
+#include <luxora/statistics.h>
+#include <stdexcept>
+
+namespace Luxora {
+
+void Statistics::add(double x) {
+    ++count;
+    double delta = x - mean;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+    sum += x;
+    min = std::min(min, x);
+    max = std::max(max, x);
+}
+
+void Statistics::merge(const Statistics& other) {
+    null_count += other.null_count;
+    if (other.count == 0) {
+        return;
+    }
+    size_t n     = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / n;
+    m2 += other.m2 + delta * delta * count * other.count / n;
+    count = n;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+double Statistics::range() const {
+    return max - min;
+}
+
+double Statistics::variance() const {
+    if (count == 0) {
+        throw std::logic_error("Not enough non missing values");
+    }
+    return m2 / count;
+}
+
+double Statistics::stddev() const {
+    return std::sqrt(variance());
+}
+
+std::ostream& operator<<(std::ostream& os, const Statistics& stats) {
+    os << "count: " << stats.count << '\n' << "null_count: " << stats.null_count << '\n';
+    if (stats.count == 0) {
+        return os;
+    }
+    os << "sum: " << stats.sum << '\n'
+       << "mean: " << stats.mean << '\n'
+       << "min: " << stats.min << '\n'
+       << "max: " << stats.max << '\n'
+       << "var: " << stats.variance() << '\n'
+       << "std: " << stats.stddev() << '\n';
+    return os;
+}
+
+} // namespace Luxora
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <luxora/stream.h>
+#include <stdexcept>
+
+namespace Luxora {
+
+BatchReader::BatchReader(const std::string& filename, size_t batch_rows, const LoadOptions& options)
+    : file(filename), body(file.view()), batch_rows(std::max<size_t>(batch_rows, 1)), options(options) {
+    header = parse_header(body);
+    select_columns(header, options.columns);
+    // Head, tail and sample narrow the whole file, not every batch.
+    body                 = reduce_records(body, header.size(), options, sampled);
+    this->options.head   = {};
+    this->options.tail   = {};
+    this->options.sample = {};
+}
+
+std::unordered_map<std::string, ColumnType> BatchReader::column_types() const {
+    std::vector<size_t> selected = select_columns(header, options.columns);
+    LoadOptions         scan     = options;
+    if (scan.inference == Inference::Sample) {
+        scan.inference = Inference::Full;
+    }
+    std::vector<ColumnType>                     types = infer_types(body, header, selected, scan);
+    std::unordered_map<std::string, ColumnType> res;
+    for (size_t j : selected) {
+        res[header[j]] = types[j];
+    }
+    return res;
+}
+
+bool BatchReader::next(DataFrame& df) {
+    if (body.empty()) {
+        return false;
+    }
+    std::string_view batch = take_records(body, batch_rows, header.size());
+    df.load_records(header, batch, options);
+    // The batch is parsed into owned storage, so its pages are not needed anymore. Sampled records are a copy.
+    if (sampled.empty()) {
+        file.release(file.view().substr(0, body.data() - file.view().data()));
+    }
+    return true;
+}
+
+Stream::Stream(std::string filename, size_t batch_rows, LoadOptions options)
+    : filename(std::move(filename)), batch_rows(batch_rows), options(std::move(options)) {
+    BatchReader reader(this->filename, 1, this->options);
+    header                     = reader.column_names();
+    this->options.column_types = reader.column_types();
+    if (!this->options.columns.empty()) {
+        header = this->options.columns;
+    }
+}
+
+StreamStats Stream::stats(const std::string& column) {
+    auto        resolved = plan();
+    StreamStats result;
+    pass(steps.size(), resolved, inputs_of(column), [&](DataFrame& df) {
+        df.convert_column<double>(column);
+        result.merge(df.column_at<double>(column).describe());
+    });
+    return result;
+}
+
+QuantileSketch Stream::sketch(const std::string& column) {
+    auto           resolved = plan();
+    QuantileSketch result;
+    pass(steps.size(), resolved, inputs_of(column), [&](DataFrame& df) {
+        df.convert_column<double>(column);
+        result.merge(df.column_at<double>(column).sketch());
+    });
+    return result;
+}
+
+std::vector<double> Stream::outliers(const std::string& column) {
+    std::vector<double> quartiles = sketch(column).quantiles(std::array{0.25f, 0.75f});
+    double              iqr       = quartiles[1] - quartiles[0];
+    double              lower = quartiles[0] - 1.5 * iqr, upper = quartiles[1] + 1.5 * iqr;
+
+    auto                resolved = plan();
+    std::vector<double> result;
+    pass(steps.size(), resolved, inputs_of(column), [&](DataFrame& df) {
+        df.convert_column<double>(column);
+        const Series<double>& values = df.column_at<double>(column);
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (values.valid(i) && (values.values()[i] < lower || values.values()[i] > upper)) {
+                result.push_back(values.values()[i]);
+            }
+        }
+    });
+    return result;
+}
+
+std::vector<std::string> Stream::inputs_of(const std::string& column) const {
+    std::vector<std::string> inputs = {column};
+    for (const auto& step : steps) {
+        inputs.push_back(step.column);
+    }
+    return inputs;
+}
+
+Stream& Stream::normalize(const std::string& column, const std::string& new_name, NormMethod method) {
+    steps.push_back({StepKind::Normalize, column, new_name.empty() ? column : new_name, method});
+    return *this;
+}
+
+Stream& Stream::fill_na(const std::string& column, Strategy strategy) {
+    if (strategy != Strategy::Mean) {
+        throw std::invalid_argument("Only mean imputation is supported for streams");
+    }
+    steps.push_back({StepKind::Impute, column, column, MinMax, strategy});
+    return *this;
+}
+
+void Stream::save(const std::string& output) {
+    std::ofstream file(output);
+    save(file);
+}
+
+void Stream::save(std::ostream& os) {
+    auto resolved = plan();
+    bool header   = true;
+    pass(steps.size(), resolved, options.columns, [&](DataFrame& df) {
+        df.write(os, "", header);
+        header = false;
+    });
+}
+
+std::vector<StreamStats> Stream::plan() {
+    std::vector<StreamStats> resolved(steps.size());
+    size_t                   planned = 0;
+    while (planned < steps.size()) {
+        // Extend the pass until a step reads a column that a step of this pass changes.
+        std::vector<std::string> changed;
+        size_t                   end = planned;
+        while (end < steps.size() && std::find(changed.begin(), changed.end(), steps[end].column) == changed.end()) {
+            changed.push_back(steps[end].target);
+            ++end;
+        }
+        std::vector<std::string> inputs;
+        for (size_t k = 0; k < end; ++k) {
+            inputs.push_back(steps[k].column);
+        }
+        pass(planned, resolved, inputs, [&](DataFrame& df) {
+            for (size_t k = planned; k < end; ++k) {
+                df.convert_column<double>(steps[k].column);
+                resolved[k].merge(df.column_at<double>(steps[k].column).describe());
+            }
+        });
+        planned = end;
+    }
+    return resolved;
+}
+
+template <class F>
+void Stream::pass(size_t applied, const std::vector<StreamStats>& resolved, std::vector<std::string> columns,
+                  F on_batch) {
+    // Columns created by steps are not in the file.
+    std::vector<std::string> load;
+    for (const auto& column : columns) {
+        if (std::find(header.begin(), header.end(), column) != header.end() &&
+            std::find(load.begin(), load.end(), column) == load.end()) {
+            load.push_back(column);
+        }
+    }
+    LoadOptions batch_options = options;
+    batch_options.columns     = columns.empty() ? options.columns : load;
+
+    BatchReader reader(filename, batch_rows, batch_options);
+    DataFrame   df;
+    while (reader.next(df)) {
+        apply(df, applied, resolved);
+        on_batch(df);
+    }
+}
+
+void Stream::apply(DataFrame& df, size_t applied, const std::vector<StreamStats>& resolved) const {
+    for (size_t k = 0; k < applied; ++k) {
+        const Step&        step  = steps[k];
+        const StreamStats& stats = resolved[k];
+        df.convert_column<double>(step.column);
+        switch (step.kind) {
+        case StepKind::Normalize:
+            if (step.method == MinMax) {
+                df.normalize<double>(step.column, step.target, stats.min, stats.range());
+            } else {
+                df.normalize<double>(step.column, step.target, stats.mean, stats.stddev());
+            }
+            break;
+        case StepKind::Impute:
+            if (stats.count == 0) {
+                throw std::logic_error("Not enough non missing values");
+            }
+            df.column_at<double>(step.column).fill_na(stats.mean);
+            break;
+        }
+    }
+}
+
+} // namespace Luxora
@@ -1,5 +1,6 @@
 #include "luxora/dataframe.h"
 #include <CLI11.hpp>
+#include <algorithm>
 #include <iostream>
 #include <luxora/luxora.h>
 #include <map>
@@ -24,9 +25,37 @@ int main() {
     CLI::App app{"CLI tool for data preparation."};
     app.set_help_all_flag("--help-all", "Expand all help");
 
+    // Patterns like `data/*.csv` are expanded while loading.
+    const CLI::Validator existing_files(
+        [](std::string& path) { return is_pattern(path) ? std::string() : CLI::ExistingFile(path); }, "FILE|PATTERN");
+
     CLI::App*   load = app.add_subcommand("load");
     std::string filename;
-    load->add_option("filename", filename, "File with data")->required()->check(CLI::ExistingFile);
+    load->add_option("filename", filename, "File with data or a pattern of files")->required()->check(existing_files);
+    LoadOptions load_options;
+    load->add_option("--columns", load_options.columns, "Load only these columns")->delimiter(',');
+    load->add_option("--na", load_options.na_tokens, "Cell values that are missing, e.g. NA,null,?")->delimiter(',');
+    load->add_option("--head", load_options.head, "Load only the first N records");
+    load->add_option("--tail", load_options.tail, "Load only the last N records");
+    load->add_option("--sample", load_options.sample, "Load a random sample, a fraction p < 1 or N records");
+    load->add_option("--seed", load_options.seed, "Seed of --sample");
+    std::string schema;
+    load->add_option("--schema", schema, "File declaring types, NA tokens and kept columns")->check(CLI::ExistingFile);
+
+    CLI::App* append = app.add_subcommand("append", "Add records of another file with the same columns");
+    append->add_option("filename", filename, "File with data or a pattern of files")
+        ->required()
+        ->check(existing_files);
+    append->add_option("--na", load_options.na_tokens, "Cell values that are missing, e.g. NA,null,?")->delimiter(',');
+
+    CLI::App* stream = app.add_subcommand("stream", "Process a file larger than memory in batches of rows");
+    size_t    batch_rows = 1 << 16;
+    stream->add_option("filename", filename, "File with data")->required()->check(CLI::ExistingFile);
+    stream->add_option("--rows", batch_rows, "Rows per batch")->default_val(batch_rows);
+    stream->add_option("--columns", load_options.columns, "Load only these columns")->delimiter(',');
+    stream->add_option("--na", load_options.na_tokens, "Cell values that are missing, e.g. NA,null,?")->delimiter(',');
+    stream->add_option("--schema", schema, "File declaring types, NA tokens and kept columns")
+        ->check(CLI::ExistingFile);
 
     CLI::App*   save   = app.add_subcommand("save");
     std::string output = "output.csv";
@@ -53,11 +82,40 @@ int main() {
     bool      zscore    = 0;
     normalize->add_flag("--zscore", zscore, "Set normalization method to Z-score instead of MinMax");
 
-    CLI::App* outliers  = app.add_subcommand("outliers", "Detect outliers");
-    bool      show_rows = false;
+    CLI::App* outliers       = app.add_subcommand("outliers", "Detect outliers");
+    bool      show_rows      = false;
+    bool      approx_outlier = false;
     outliers->add_flag("--rows", show_rows, "Show table rows instead of values");
+    outliers->add_flag("--approx", approx_outlier, "Take quartiles from a quantile sketch, works for streams");
+
+    bool approx_median = false;
+
+    CLI::App*   where       = app.add_subcommand("where", "Show rows in which the selected column equals a value");
+    std::string where_value;
+    where->add_option("value", where_value, "Value to look for")->required();
+
+    CLI::App* counts = app.add_subcommand("counts", "Number of rows of every value of selected column");
 
-    DataFrame df;
+    CLI::App* describe = app.add_subcommand("describe", "Count, sum, mean, min, max and spread of selected column");
+
+    CLI::App*          quantiles = app.add_subcommand("quantiles", "Quantiles of selected column");
+    std::vector<float> quantile_levels;
+    quantiles->add_option("q", quantile_levels, "Fractions of values below each quantile, e.g. 0.01 0.5 0.99")
+        ->required()
+        ->check(CLI::Range(0.0, 1.0));
+
+    DataFrame             df;
+    std::optional<Stream> streamed;
+
+    std::unordered_map<std::string, std::function<double(const StreamStats&)>> stream_statistics = {
+        {"sum", [](const StreamStats& s) { return s.sum; }},
+        {"mean", [](const StreamStats& s) { return s.mean; }},
+        {"min", [](const StreamStats& s) { return s.min; }},
+        {"max", [](const StreamStats& s) { return s.max; }},
+        {"range", [](const StreamStats& s) { return s.range(); }},
+        {"var", [](const StreamStats& s) { return s.variance(); }},
+        {"std", [](const StreamStats& s) { return s.stddev(); }},
+    };
 
     std::unordered_map<std::string, CLI::App*> action_apps;
 
@@ -67,22 +125,23 @@ int main() {
             "sum",
             {
                 "Sum of selected column",
-                [&df, &column_from_name]() { std::cout << df.column_at<float>(column_from_name).sum() << std::endl; },
+                [&df, &column_from_name]() { std::cout << df.column_at<double>(column_from_name).sum() << std::endl; },
             },
         },
         {
             "mean",
             {
                 "Mean of selected column",
-                [&df, &column_from_name]() { std::cout << df.column_at<float>(column_from_name).mean() << std::endl; },
+                [&df, &column_from_name]() { std::cout << df.column_at<double>(column_from_name).mean() << std::endl; },
             },
         },
         {
             "median",
             {
                 "Median of selected column",
-                [&df, &column_from_name]() {
-                    std::cout << df.column_at<float>(column_from_name).median() << std::endl;
+                [&df, &column_from_name, &approx_median]() {
+                    Series<double>& column = df.column_at<double>(column_from_name);
+                    std::cout << (approx_median ? column.sketch().quantile(0.5) : column.median()) << std::endl;
                 },
             },
         },
@@ -90,21 +149,23 @@ int main() {
             "min",
             {
                 "Min of selected column",
-                [&df, &column_from_name]() { std::cout << df.column_at<float>(column_from_name).min() << std::endl; },
+                [&df, &column_from_name]() { std::cout << df.column_at<double>(column_from_name).min() << std::endl; },
             },
         },
         {
             "max",
             {
                 "Max of selected column",
-                [&df, &column_from_name]() { std::cout << df.column_at<float>(column_from_name).max() << std::endl; },
+                [&df, &column_from_name]() { std::cout << df.column_at<double>(column_from_name).max() << std::endl; },
             },
         },
         {
             "range",
             {
                 "Range of selected column",
-                [&df, &column_from_name]() { std::cout << df.column_at<float>(column_from_name).range() << std::endl; },
+                [&df, &column_from_name]() {
+                    std::cout << df.column_at<double>(column_from_name).range() << std::endl;
+                },
             },
         },
         {
@@ -112,7 +173,7 @@ int main() {
             {
                 "Variance of selected column",
                 [&df, &column_from_name]() {
-                    std::cout << df.column_at<float>(column_from_name).variance() << std::endl;
+                    std::cout << df.column_at<double>(column_from_name).variance() << std::endl;
                 },
             },
         },
@@ -121,7 +182,7 @@ int main() {
             {
                 "Standard deviation of selected column",
                 [&df, &column_from_name]() {
-                    std::cout << df.column_at<float>(column_from_name).stddev() << std::endl;
+                    std::cout << df.column_at<double>(column_from_name).stddev() << std::endl;
                 },
             },
         },
@@ -130,6 +191,7 @@ int main() {
     for (auto& [name, action] : actions) {
         action_apps[name] = app.add_subcommand(name, action.first);
     }
+    action_apps["median"]->add_flag("--approx", approx_median, "Estimate from a quantile sketch, works for streams");
 
     app.require_subcommand(1, 1);
 
@@ -139,6 +201,13 @@ int main() {
         if (!std::getline(std::cin, line)) {
             break;
         }
+        // Bound variables keep values of the previous line unless they are given again.
+        load_options = {};
+        schema.clear();
+        zscore         = false;
+        show_rows      = false;
+        approx_outlier = false;
+        approx_median  = false;
         try {
             app.parse(line);
         } catch (const CLI::CallForHelp& e) {
@@ -154,40 +223,145 @@ int main() {
             std::cerr << "An error has occured: \n" << e.what() << std::endl;
             continue;
         }
-
-        if (load->parsed()) {
-            df.load(filename);
-        } else if (save->parsed()) {
-            df.save(output);
-        } else if (exit->parsed()) {
-            break;
-        } else if (impute->parsed()) {
-            df.convert_column<float>(column_from_name);
-            df.fill_na(column_from_name, strategy);
-        } else if (normalize->parsed()) {
-            df.convert_column<float>(column_from_name);
-            if (zscore) {
-                df.normalize<float>(column_from_name, column_to_name, Luxora::Zscore);
-            } else {
-                df.normalize<float>(column_from_name, column_to_name);
-            }
-        } else if (outliers->parsed()) {
-            df.convert_column<float>(column_from_name);
-            std::cout << "Outliers: ";
-            if (show_rows) {
-                auto indices = df.outlier_indices<float>(column_from_name);
-                std::cout << std::endl;
-                df.choose_rows(std::cout, indices);
-            } else {
-                auto values = df.outliers<float>(column_from_name);
-                std::cout << values << std::endl;
-            }
+        bool column_command = impute->parsed() || normalize->parsed() || where->parsed() || counts->parsed() ||
+                              describe->parsed() || quantiles->parsed() || outliers->parsed() ||
+                              std::any_of(action_apps.begin(), action_apps.end(), [](const auto& ac_app) {
+                                  return ac_app.first != "print" && ac_app.second->parsed();
+                              });
+        if (column_command && column_from_name.empty()) {
+            std::cerr << "Select a column with `from` first" << std::endl;
+            continue;
         }
-        for (auto ac_app : action_apps) {
-            if (ac_app.second->parsed()) {
-                df.convert_column<float>(column_from_name);
+        // Errors of a command leave data as it was and the next command is read.
+        try {
+            if (load->parsed()) {
+                streamed.reset();
+                try {
+                    if (!schema.empty()) {
+                        read_schema(schema, load_options);
+                    }
+                    df.load(filename, load_options);
+                } catch (const std::exception& e) {
+                    df = DataFrame();
+                    std::cerr << "An error has occured: \n" << e.what() << std::endl;
+                }
+            } else if (append->parsed()) {
+                if (streamed) {
+                    std::cerr << "Append is not supported for streams" << std::endl;
+                    continue;
+                }
+                try {
+                    df.append(filename, load_options);
+                } catch (const std::exception& e) {
+                    // Loaded data stays as it was.
+                    std::cerr << "An error has occured: \n" << e.what() << std::endl;
+                }
+            } else if (stream->parsed()) {
+                streamed.reset();
+                if (!schema.empty()) {
+                    read_schema(schema, load_options);
+                }
+                streamed.emplace(filename, batch_rows, load_options);
+            } else if (save->parsed()) {
+                if (streamed) {
+                    streamed->save(output);
+                } else {
+                    df.save(output);
+                }
+            } else if (exit->parsed()) {
+                break;
+            } else if (impute->parsed()) {
+                if (streamed) {
+                    streamed->fill_na(column_from_name, strategy);
+                    continue;
+                }
+                df.convert_column<double>(column_from_name);
+                df.fill_na(column_from_name, strategy);
+            } else if (normalize->parsed()) {
+                if (streamed) {
+                    streamed->normalize(column_from_name, column_to_name, zscore ? Luxora::Zscore : Luxora::MinMax);
+                    continue;
+                }
+                df.convert_column<double>(column_from_name);
+                if (zscore) {
+                    df.normalize<double>(column_from_name, column_to_name, Luxora::Zscore);
+                } else {
+                    df.normalize<double>(column_from_name, column_to_name);
+                }
+            } else if (where->parsed() || counts->parsed()) {
+                if (streamed) {
+                    std::cerr << "`" << (where->parsed() ? "where" : "counts") << "` is not supported for streams"
+                              << std::endl;
+                    continue;
+                }
+                if (where->parsed()) {
+                    df.choose_rows(std::cout, df.rows_equal(column_from_name, where_value));
+                    continue;
+                }
+                for (const auto& [value, n] : df.value_counts(column_from_name)) {
+                    std::cout << value << ": " << n << std::endl;
+                }
+            } else if (describe->parsed()) {
+                if (streamed) {
+                    std::cout << streamed->stats(column_from_name);
+                    continue;
+                }
+                df.convert_column<double>(column_from_name);
+                std::cout << df.column_at<double>(column_from_name).describe();
+            } else if (quantiles->parsed()) {
+                if (streamed) {
+                    std::cerr << "Quantiles are not supported for streams" << std::endl;
+                    continue;
+                }
+                df.convert_column<double>(column_from_name);
+                std::vector<double> values = df.column_at<double>(column_from_name).quantiles(quantile_levels);
+                for (size_t i = 0; i < values.size(); ++i) {
+                    std::cout << quantile_levels[i] << ": " << values[i] << std::endl;
+                }
+            } else if (outliers->parsed()) {
+                if (streamed) {
+                    if (!approx_outlier || show_rows) {
+                        std::cerr << "Only `outliers --approx` is supported for streams" << std::endl;
+                        continue;
+                    }
+                    std::cout << "Outliers: " << streamed->outliers(column_from_name) << std::endl;
+                    continue;
+                }
+                df.convert_column<double>(column_from_name);
+                std::cout << "Outliers: ";
+                if (show_rows) {
+                    auto indices = df.outlier_indices<double>(column_from_name, approx_outlier);
+                    std::cout << std::endl;
+                    df.choose_rows(std::cout, indices);
+                } else {
+                    auto values = df.outliers<double>(column_from_name, approx_outlier);
+                    std::cout << values << std::endl;
+                }
+            }
+            for (auto ac_app : action_apps) {
+                if (!ac_app.second->parsed()) {
+                    continue;
+                }
+                if (streamed && ac_app.first == "median" && approx_median) {
+                    std::cout << streamed->sketch(column_from_name).quantile(0.5) << std::endl;
+                    continue;
+                }
+                if (streamed) {
+                    auto statistic = stream_statistics.find(ac_app.first);
+                    if (statistic == stream_statistics.end()) {
+                        std::cerr << "`" << ac_app.first << "` is not supported for streams" << std::endl;
+                    } else {
+                        std::cout << statistic->second(streamed->stats(column_from_name)) << std::endl;
+                    }
+                    continue;
+                }
+                if (ac_app.first != "print") {
+                    df.convert_column<double>(column_from_name);
+                }
                 actions[ac_app.first].second();
             }
+        } catch (const std::exception& e) {
+            std::cerr << "An error has occured: \n" << e.what() << std::endl;
         }
     }
 
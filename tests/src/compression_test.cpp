@@ -0,0 +1,98 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <luxora/compression.h>
+#include <luxora/dataframe.h>
+#include <sstream>
+#include <string>
+
+using namespace Luxora;
+
+TEST(CompressionTest, Detect) {
+    ASSERT_EQ(detect_compression("\x1f\x8b\x08"), Compression::Gzip);
+    ASSERT_EQ(detect_compression("\x28\xb5\x2f\xfd"), Compression::Zstd);
+    ASSERT_EQ(detect_compression("Open,High\n"), Compression::None);
+    ASSERT_EQ(detect_compression(""), Compression::None);
+}
+
+TEST(CompressionTest, RingOfBuffers) {
+    // Buffers much smaller than the file make the worker wait for the consumer many times.
+    Decompressor input("resources/missing.csv", 7, 2);
+    std::string  content;
+    for (auto piece = input.next(); !piece.empty(); piece = input.next()) {
+        ASSERT_LE(piece.size(), 7);
+        content.append(piece);
+    }
+    ASSERT_EQ(content, MappedFile("resources/missing.csv").view());
+    ASSERT_TRUE(input.next().empty());
+}
+
+TEST(CompressionTest, LoadCompressed) {
+    DataFrame plain("resources/missing.csv");
+    std::ostringstream expected;
+    expected << plain;
+    for (std::string filename : {"resources/missing.csv.gz", "resources/missing.csv.zst"}) {
+        if (!compression_supported(detect_compression(MappedFile(filename).view()))) {
+            ASSERT_THROW(DataFrame{filename}, std::runtime_error);
+            continue;
+        }
+        DataFrame df(filename);
+        ASSERT_EQ(df.shape, plain.shape);
+        ASSERT_EQ(df.column_at<int64_t>("Volume"), plain.column_at<int64_t>("Volume"));
+        std::ostringstream oss;
+        oss << df;
+        ASSERT_EQ(oss.str(), expected.str());
+    }
+}
+
+TEST(CompressionTest, TruncatedInput) {
+    for (std::string filename : {"resources/missing.csv.gz", "resources/missing.csv.zst"}) {
+        MappedFile       file(filename);
+        std::string_view content = file.view();
+        if (!compression_supported(detect_compression(content))) {
+            continue;
+        }
+        auto path = std::filesystem::temp_directory_path() / ("luxora-truncated" + filename.substr(17));
+        std::ofstream(path) << content.substr(0, content.size() - 12);
+        ASSERT_THROW(DataFrame{path.string()}, std::runtime_error);
+        std::filesystem::remove(path);
+    }
+}
+
+TEST(CompressionTest, PiecesSplitRecords) {
+    // Pieces end in the middle of records and quoted line breaks, late cells turn a numeric column into strings.
+    std::string csv = "id,text,value\n";
+    for (int i = 0; i < 200; ++i) {
+        csv += std::to_string(i) + ",\"a\nb\"," + (i == 150 ? "oops" : std::to_string(i * 2)) + "\n";
+    }
+    size_t        opened = 0;
+    SourceFactory open   = [&]() -> PieceSource {
+        ++opened;
+        return [rest = std::string_view(csv)]() mutable {
+            std::string_view piece = rest.substr(0, 13);
+            rest.remove_prefix(piece.size());
+            return piece;
+        };
+    };
+    std::vector<std::string> header;
+    std::vector<size_t>      selected;
+    size_t                   records;
+    LoadOptions              options;
+    options.sample_rows = 10;
+    options.columns     = {"value", "id"};
+    auto columns        = read_pieces(open, header, selected, records, options);
+    ASSERT_EQ(records, 200);
+    ASSERT_EQ(opened, 2);
+    ASSERT_EQ(selected, std::vector<size_t>({2, 0}));
+    ASSERT_EQ(columns[0]->type(), typeid(std::string));
+    ASSERT_EQ(columns[0]->string_at(150), "oops");
+    ASSERT_EQ(columns[1]->type(), typeid(int64_t));
+    ASSERT_EQ(columns[1]->string_at(199), "199");
+
+    // Without a failed guess the input is read once.
+    opened          = 0;
+    options         = {};
+    options.columns = {"id"};
+    columns         = read_pieces(open, header, selected, records, options);
+    ASSERT_EQ(opened, 1);
+}
@@ -0,0 +1,269 @@
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <luxora/csv.h>
+#include <luxora/dataframe.h>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+using namespace Luxora;
+
+TEST(CsvTest, Header) {
+    std::string_view buffer = "\xEF\xBB\xBF" "a,\"b,c\",d\r\n1,2,3\n";
+    auto             names  = parse_header(buffer);
+    ASSERT_EQ(names, std::vector<std::string>({"a", "b,c", "d"}));
+    ASSERT_EQ(buffer, "1,2,3\n");
+}
+
+TEST(CsvTest, QuotedCells) {
+    StringColumnBuilder         first, second;
+    std::vector<ColumnBuilder*> builders = {&first, &second};
+    size_t                      records  = parse_records("\"x, \"\"y\"\"\",1\n\n\"multi\nline\",\r\nlast", builders);
+    ASSERT_EQ(records, 3);
+
+    auto strings = dynamic_cast<Series<std::string>&>(*first.finish());
+    ASSERT_EQ(strings, Series<std::string>({"x, \"y\"", "multi\nline", "last"}));
+    auto numbers = dynamic_cast<Series<std::string>&>(*second.finish());
+    ASSERT_EQ(numbers, Series<std::string>({"1", {}, {}}));
+}
+
+TEST(CsvTest, QuoteFreeRecords) {
+    // Without a limit the quote free body takes the fast path, with one the general tokenizer runs.
+    std::string_view body = "a,1\r\n\nb,\nc,3,\n";
+    for (size_t limit : {size_t(3), std::numeric_limits<size_t>::max()}) {
+        StringColumnBuilder         first, second;
+        std::vector<ColumnBuilder*> builders = {&first, &second};
+        ASSERT_THROW(parse_records(body, builders, ',', limit), std::runtime_error);
+
+        StringColumnBuilder         third, fourth, fifth;
+        std::vector<ColumnBuilder*> wide = {&third, &fourth, &fifth};
+        ASSERT_EQ(parse_records(body, wide, ',', limit), 3);
+        ASSERT_EQ(dynamic_cast<Series<std::string>&>(*third.finish()), Series<std::string>({"a", "b", "c"}));
+        ASSERT_EQ(dynamic_cast<Series<std::string>&>(*fourth.finish()), Series<std::string>({"1", {}, "3"}));
+        ASSERT_EQ(dynamic_cast<Series<std::string>&>(*fifth.finish()), Series<std::string>({{}, {}, {}}));
+
+        StringColumnBuilder         empty;
+        std::vector<ColumnBuilder*> single = {&empty};
+        ASSERT_EQ(parse_records(std::string_view(), single, ',', limit), 0);
+    }
+}
+
+TEST(CsvTest, MalformedRecords) {
+    StringColumnBuilder         column;
+    std::vector<ColumnBuilder*> builders = {&column};
+    ASSERT_THROW(parse_records("1,2\n", builders), std::runtime_error);
+    ASSERT_THROW(parse_records("\"unterminated\n", builders), std::runtime_error);
+
+    // The number of a record that is too long counts records of all chunks before its own.
+    std::string body;
+    for (int i = 0; i < 1000; ++i) {
+        body += i == 700 ? "1,2\n" : "1\n";
+    }
+    for (size_t threads : {1, 4}) {
+        size_t      records;
+        LoadOptions options;
+        options.threads        = threads;
+        options.min_chunk_size = 64;
+        try {
+            parse_records_parallel(
+                body, 1, [](size_t) { return std::make_unique<StringColumnBuilder>(); }, records, options);
+            FAIL();
+        } catch (const MalformedRecord& e) {
+            ASSERT_EQ(e.record, 700);
+            ASSERT_STREQ(e.what(), "Record 701 has more cells than the header");
+        }
+        ASSERT_THROW(RecordIndex(body, 1, options), MalformedRecord);
+    }
+}
+
+TEST(CsvTest, MappedFile) {
+    ASSERT_THROW(MappedFile("resources/does-not-exist.csv"), std::runtime_error);
+    MappedFile file("resources/full.csv");
+    ASSERT_TRUE(file.view().starts_with("Open,High,Low,Close,Volume,Adj Close\n"));
+}
+
+TEST(CsvTest, SplitRecords) {
+    std::string_view body   = "1,\"a\nb\"\n2,\"c\n\nd\"\n3,e\n4,f\n";
+    auto             chunks = split_records(body, 8, 4);
+    std::string      joined;
+    for (auto chunk : chunks) {
+        ASSERT_TRUE(chunk.ends_with('\n'));
+        ASSERT_TRUE(chunk.front() >= '1' && chunk.front() <= '4');
+        joined += chunk;
+    }
+    ASSERT_EQ(joined, body);
+    ASSERT_GT(chunks.size(), 1);
+}
+
+/// Options that only narrow records down.
+LoadOptions reduction(std::optional<size_t> head, std::optional<size_t> tail = {}, std::optional<double> sample = {},
+                      std::optional<uint64_t> seed = {}) {
+    LoadOptions options;
+    options.head   = head;
+    options.tail   = tail;
+    options.sample = sample;
+    options.seed   = seed;
+    return options;
+}
+
+TEST(CsvTest, ReduceRecords) {
+    std::string_view body = "1,a\n2,\"b\nc\"\n3,d\n4,e";
+    std::string      storage;
+    ASSERT_EQ(reduce_records(body, 2, reduction(2), storage), "1,a\n2,\"b\nc\"\n");
+    ASSERT_EQ(reduce_records(body, 2, reduction({}, 3), storage), "2,\"b\nc\"\n3,d\n4,e");
+    ASSERT_EQ(reduce_records(body, 2, reduction(3, 1), storage), "3,d\n");
+    ASSERT_EQ(reduce_records(body, 2, reduction({}, 9), storage), body);
+
+    // Empty lines are skipped like the tokenizer does.
+    std::string_view blanks = "1,a\n\n\r\n2,b\n3,c\n\n\n";
+    ASSERT_EQ(reduce_records(blanks, 2, reduction(2), storage), "1,a\n\n\r\n2,b\n");
+    ASSERT_EQ(reduce_records(blanks, 2, reduction({}, 1), storage), "3,c\n\n\n");
+    ASSERT_EQ(reduce_records(blanks, 2, reduction({}, 2), storage), "2,b\n3,c\n\n\n");
+    ASSERT_EQ(reduce_records(blanks, 2, reduction({}, {}, 3), storage), "1,a\n2,b\n3,c\n");
+
+    // An empty line of a single column is a record, nothing after the last line break is not.
+    std::string_view single = "1\n\n3\n";
+    ASSERT_EQ(reduce_records(single, 1, reduction(2), storage), "1\n\n");
+    ASSERT_EQ(reduce_records(single, 1, reduction({}, 2), storage), "\n3\n");
+    StringColumnBuilder         cells;
+    std::vector<ColumnBuilder*> builders = {&cells};
+    ASSERT_EQ(parse_records(single, builders, ','), 3);
+    ASSERT_EQ(dynamic_cast<Series<std::string>&>(*cells.finish()), Series<std::string>({"1", {}, "3"}));
+
+    ASSERT_EQ(reduce_records(body, 2, reduction({}, {}, 4), storage), "1,a\n2,\"b\nc\"\n3,d\n4,e\n");
+    std::string_view sampled = reduce_records(body, 2, reduction({}, {}, 2, 7), storage);
+    ASSERT_EQ(std::count(sampled.begin(), sampled.end(), '\n'), 2 + sampled.contains("b\nc"));
+    ASSERT_EQ(reduce_records(body, 2, reduction({}, {}, 0.5, 7), storage),
+              reduce_records(body, 2, reduction({}, {}, 0.5, 7), storage));
+
+    // A quote inside an unquoted cell is an ordinary character, as the tokenizer reads it.
+    std::string quotes;
+    for (int i = 0; i < 21; ++i) {
+        quotes += std::to_string(i) + (i % 7 ? ",plain,x\n" : ",5\" screen,x\n");
+    }
+    ASSERT_EQ(reduce_records(quotes, 3, reduction(3), storage), "0,5\" screen,x\n1,plain,x\n2,plain,x\n");
+    ASSERT_EQ(reduce_records(quotes, 3, reduction({}, 3), storage), "18,plain,x\n19,plain,x\n20,plain,x\n");
+    ASSERT_EQ(reduce_records(quotes, 3, reduction(15, 2), storage), "13,plain,x\n14,5\" screen,x\n");
+    sampled = reduce_records(quotes, 3, reduction({}, {}, 5, 7), storage);
+    ASSERT_EQ(std::count(sampled.begin(), sampled.end(), '\n'), 5);
+    ASSERT_EQ(std::count(sampled.begin(), sampled.end(), 'x'), 5);
+}
+
+TEST(CsvTest, Schema) {
+    LoadOptions options;
+    parse_schema("column,type,na,keep\nid,int64,,\nname,string,- ?,\nscore,double,,no\n", options);
+    ASSERT_EQ(options.columns, std::vector<std::string>({"id", "name"}));
+    ASSERT_EQ(options.column_types.at("score"), ColumnType::Double);
+    ASSERT_EQ(options.column_na_tokens.at("name"), std::vector<std::string>({"-", "?"}));
+
+    ASSERT_THROW(parse_schema("column,type\nid,float\n", options), std::invalid_argument);
+    ASSERT_THROW(parse_schema("name,kind\nid,int64\n", options), std::invalid_argument);
+}
+
+TEST(CsvTest, ParallelLoad) {
+    std::string csv = "id,text\n";
+    for (int i = 0; i < 1000; ++i) {
+        csv += std::to_string(i) + (i % 7 ? ",plain\n" : ",\"quoted\nline\"\n");
+    }
+    DataFrame          sequential, parallel;
+    std::istringstream iss1(csv), iss2(csv);
+    LoadOptions        options;
+    options.threads = 1;
+    sequential.load(iss1, options);
+    options.threads        = 4;
+    options.min_chunk_size = 64;
+    parallel.load(iss2, options);
+    ASSERT_EQ(parallel.shape, std::make_pair(1000, 2));
+
+    std::ostringstream oss1, oss2;
+    oss1 << sequential;
+    oss2 << parallel;
+    ASSERT_EQ(oss1.str(), oss2.str());
+}
+
+TEST(CsvTest, ParallelLoadMidCellQuotes) {
+    // Quotes inside unquoted cells are ordinary characters, so they do not flip quoting for the chunk split.
+    std::string csv = "id,text,size\n";
+    for (int i = 0; i < 4000; ++i) {
+        csv += std::to_string(i) + (i % 5 == 0 ? ",\"multi\nline\"" : i % 3 ? ",plain" : ",5\" screen") + ",x\n";
+    }
+    std::string expected;
+    for (size_t threads : {1, 16}) {
+        std::istringstream iss(csv);
+        LoadOptions        options;
+        options.threads        = threads;
+        options.min_chunk_size = 64;
+        DataFrame df;
+        df.load(iss, options);
+        ASSERT_EQ(df.shape, std::make_pair(4000, 3));
+        std::ostringstream oss;
+        oss << df;
+        if (expected.empty()) {
+            expected = oss.str();
+        }
+        ASSERT_EQ(oss.str(), expected);
+    }
+    for (auto chunk : split_records(std::string_view(csv).substr(csv.find('\n') + 1), 64, 4)) {
+        ASSERT_TRUE(chunk.ends_with(",x\n"));
+    }
+}
+
+TEST(CsvTest, InferTypes) {
+    std::string_view         body   = "1,1.5,a,\n2,2,b,\n+3,-1e3,c,\n";
+    std::vector<std::string> header = {"a", "b", "c", "d"};
+    std::vector<size_t>      all    = {0, 1, 2, 3};
+    LoadOptions              options;
+    options.inference = Inference::Full;
+    auto types        = infer_types(body, header, all, options);
+    ASSERT_EQ(types, std::vector<ColumnType>({ColumnType::Int64, ColumnType::Double, ColumnType::String,
+                                              ColumnType::Int64}));
+    options.inference = Inference::None;
+    ASSERT_EQ(infer_types(body, header, all, options)[0], ColumnType::String);
+    ASSERT_EQ(infer_types(body, header, std::vector<size_t>{1})[0], ColumnType::String);
+
+    options.inference = Inference::Full;
+    ASSERT_EQ(infer_types("nan\ninf\n", {"name"}, std::vector<size_t>{0}, options)[0], ColumnType::String);
+    ASSERT_EQ(classify("-infinity"), ColumnType::String);
+}
+
+TEST(CsvTest, SampledTypesFallBack) {
+    std::string_view         body    = "1,1\n2,2\n3,2.5\n4,x\n";
+    std::vector<std::string> header  = {"a", "b"};
+    std::vector<size_t>      both    = {0, 1};
+    size_t                   records;
+    LoadOptions              options;
+    options.sample_rows = 2;
+    auto columns        = read_columns(body, header, both, records, options);
+    ASSERT_EQ(records, 4);
+    ASSERT_EQ(dynamic_cast<Series<int64_t>&>(*columns[0]), Series<int64_t>({1, 2, 3, 4}));
+    ASSERT_EQ(dynamic_cast<Series<std::string>&>(*columns[1]), Series<std::string>({"1", "2", "2.5", "x"}));
+
+    options.sample_rows = 1;
+    columns             = read_columns("1\n2.5\n", {"a"}, std::vector<size_t>{0}, records, options);
+    ASSERT_EQ(dynamic_cast<Series<double>&>(*columns[0]), Series<double>({1.0, 2.5}));
+
+    columns = read_columns("2.5\nnan\n", {"a"}, std::vector<size_t>{0}, records, options);
+    ASSERT_EQ(dynamic_cast<Series<std::string>&>(*columns[0]), Series<std::string>({"2.5", "nan"}));
+}
+
+TEST(CsvTest, NaTokens) {
+    std::string_view         body   = "1,NA,x\n?,2.5,null\nNA,-,y\n";
+    std::vector<std::string> header = {"a", "b", "c"};
+    std::vector<size_t>      all    = {0, 1, 2};
+    size_t                   records;
+    LoadOptions              options;
+    options.na_tokens        = {"NA", "?", "null"};
+    options.column_na_tokens = {{"b", {"NA", "-"}}};
+    auto columns             = read_columns(body, header, all, records, options);
+    ASSERT_EQ(dynamic_cast<Series<int64_t>&>(*columns[0]), Series<int64_t>({1, {}, {}}));
+    ASSERT_EQ(dynamic_cast<Series<double>&>(*columns[1]), Series<double>({{}, 2.5, {}}));
+    ASSERT_EQ(dynamic_cast<Series<std::string>&>(*columns[2]), Series<std::string>({"x", {}, "y"}));
+
+    NaTokens na({"NA", "a very long missing value marker that does not fit the length mask"});
+    ASSERT_TRUE(na.contains(""));
+    ASSERT_TRUE(na.contains("a very long missing value marker that does not fit the length mask"));
+    ASSERT_FALSE(na.contains("a very long missing value marker that does not fit the length mask!"));
+    ASSERT_FALSE(na.contains("N"));
+}
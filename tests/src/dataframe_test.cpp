@@ -1,3 +1,5 @@
+#include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <luxora/dataframe.h>
 #include <luxora/luxora.h>
@@ -140,3 +142,221 @@ TEST(DataFrameTest, FillNaTest) {
 64.610001,64.949997,64.449997,64.489998,19384900,64.489998\n\
 64.470001,64.690002,64.300003,64.555000,21234600,64.620003\n");
 }
+
+TEST(DataFrameTest, InferredTypes) {
+    DataFrame df("resources/timeseries.csv");
+    ASSERT_NO_THROW(df.column_at<int64_t>("Value"));
+    ASSERT_NO_THROW(df.categorical_at("Category"));
+    ASSERT_NO_THROW(df.column_at<std::string>("Category"));
+    ASSERT_EQ(df.column_at<std::string>("Category").string_at(5), "B");
+    ASSERT_THROW(df.categorical_at("Category"), std::invalid_argument);
+    ASSERT_NO_THROW(df.column_at<std::string>("Timestamp"));
+    ASSERT_THROW(df.column_at<int64_t>("Nope"), std::invalid_argument);
+    ASSERT_EQ(df.column_at<int64_t>("Value").max(), 5000);
+
+    DataFrame   strings;
+    LoadOptions options;
+    options.inference = Inference::None;
+    strings.load("resources/missing.csv", options);
+    ASSERT_NO_THROW(strings.column_at<std::string>("Close"));
+    ASSERT_EQ(strings.column_at<std::string>("Close").count(), 4);
+    ASSERT_EQ(DataFrame("resources/missing.csv").column_at<double>("Close").count(), 4);
+}
+
+TEST(DataFrameTest, ColumnProjection) {
+    DataFrame   df;
+    LoadOptions options;
+    options.columns = {"Volume", "Close"};
+    df.load("resources/missing.csv", options);
+    ASSERT_EQ(df.shape, std::make_pair(5, 2));
+    std::ostringstream oss;
+    oss << df;
+    ASSERT_EQ(oss.str(), "Volume,Close\n21705200,64.620003\n20235200,64.620003\n19259700,64.360001\n\
+19384900,64.489998\n21234600,`None`\n");
+
+    options.columns = {"Missing"};
+    ASSERT_THROW(df.load("resources/missing.csv", options), std::invalid_argument);
+}
+
+TEST(DataFrameTest, HeadTailSample) {
+    DataFrame   df;
+    LoadOptions options;
+    options.columns = {"Volume"};
+    options.head    = 2;
+    df.load("resources/missing.csv", options);
+    ASSERT_EQ(df.shape, std::make_pair(2, 1));
+    ASSERT_EQ(df.column_at<int64_t>("Volume"), Series<int64_t>({21705200, 20235200}));
+
+    options.head = {};
+    options.tail = 2;
+    df.load("resources/missing.csv", options);
+    ASSERT_EQ(df.column_at<int64_t>("Volume"), Series<int64_t>({19384900, 21234600}));
+
+    options        = {};
+    options.sample = 3;
+    options.seed   = 1;
+    df.load("resources/missing.csv", options);
+    ASSERT_EQ(df.shape, std::make_pair(3, 6));
+}
+
+TEST(DataFrameTest, Schema) {
+    LoadOptions options;
+    read_schema("resources/missing.schema", options);
+    DataFrame df;
+    df.load("resources/missing.csv", options);
+    ASSERT_EQ(df.shape, std::make_pair(5, 3));
+    ASSERT_EQ(df.column_at<int64_t>("Volume"), Series<int64_t>({21705200, 20235200, 19259700, 19384900, 21234600}));
+    ASSERT_EQ(df.column_at<std::string>("Adj Close").string_at(0), "64.620003");
+    ASSERT_FALSE(df.column_at<double>("Close").string_at(4).has_value());
+
+    // Declared types are not promoted.
+    std::istringstream iss("Value\n1\n2.5\n");
+    LoadOptions        declared;
+    declared.column_types = {{"Value", ColumnType::Int64}};
+    ASSERT_THROW(df.load(iss, declared), std::invalid_argument);
+}
+
+TEST(DataFrameTest, SingleColumnEmptyLines) {
+    for (bool lazy : {true, false}) {
+        std::istringstream iss("a\n1\n\n3\n");
+        LoadOptions        options;
+        options.lazy = lazy;
+        DataFrame df;
+        df.load(iss, options);
+        ASSERT_EQ(df.shape, std::make_pair(3, 1));
+        ASSERT_EQ(df.column_at<int64_t>("a"), Series<int64_t>({1, {}, 3}));
+    }
+}
+
+TEST(DataFrameTest, LazyColumns) {
+    std::istringstream iss("id,name,score\n1,\"Smith, \"\"J\"\"\",NA\n2,x,1.50\n3\n");
+    DataFrame          df;
+    LoadOptions        options;
+    options.na_tokens = {"NA"};
+    df.load(iss, options);
+    ASSERT_EQ(df.shape, std::make_pair(3, 3));
+
+    // Untouched columns are saved from the source text, with NA tokens written as empty cells.
+    std::ostringstream untouched;
+    df.save(untouched);
+    ASSERT_EQ(untouched.str(), "id,name,score\n1,\"Smith, \"\"J\"\"\",\n2,x,1.50\n3,,\n");
+
+    ASSERT_EQ(df.column_at<int64_t>("id"), Series<int64_t>({1, 2, 3}));
+    ASSERT_EQ(df.column_at<std::string>("name"), Series<std::string>({"Smith, \"J\"", "x", {}}));
+    ASSERT_EQ(df.column_at<double>("score"), Series<double>({{}, 1.5, {}}));
+
+    std::istringstream eager("id,name,score\n1,\"Smith, \"\"J\"\"\",NA\n2,x,1.50\n3\n");
+    DataFrame          parsed;
+    options.lazy = false;
+    parsed.load(eager, options);
+    ASSERT_EQ(parsed.column_at<std::string>("name"), df.column_at<std::string>("name"));
+    ASSERT_EQ(parsed.column_at<double>("score"), df.column_at<double>("score"));
+}
+
+TEST(DataFrameTest, Append) {
+    DataFrame   df;
+    LoadOptions options;
+    options.columns = {"Volume", "Close"};
+    df.load("resources/missing.csv", options);
+    df.convert_column<float>("Close");
+    float median = df.column_at<float>("Close").quantile(0.5);
+    df.append("resources/full.csv");
+    ASSERT_EQ(df.shape, std::make_pair(10, 2));
+    ASSERT_EQ(df.column_at<int64_t>("Volume").string_at(5), "21705200");
+    ASSERT_EQ(df.column_at<float>("Close").count(), 9);
+    ASSERT_LE(median, df.column_at<float>("Close").quantile(0.9));
+
+    std::istringstream wrong("Open,Volume\n1,2\n");
+    ASSERT_THROW(df.append(wrong), std::invalid_argument);
+    ASSERT_EQ(df.shape, std::make_pair(10, 2));
+
+    // Columns are matched by name, a data frame of all columns of its file takes no other columns.
+    DataFrame          all;
+    std::istringstream head("b,a\nx,1\n");
+    all.load(head);
+    std::istringstream swapped("a,b\n2,y\n");
+    all.append(swapped);
+    ASSERT_EQ(all.column_at<int64_t>("a"), Series<int64_t>({1, 2}));
+    std::istringstream extra("a,b,c\n3,z,4\n");
+    ASSERT_THROW(all.append(extra), std::invalid_argument);
+    // A cell that does not parse fails the whole append, columns before its column do not grow.
+    std::istringstream broken("b,a\nw,oops\n");
+    ASSERT_THROW(all.append(broken), std::invalid_argument);
+    ASSERT_EQ(all.shape, std::make_pair(2, 2));
+    ASSERT_EQ(all.column_at<std::string>("b").size(), 2);
+}
+
+TEST(DataFrameTest, LoadPattern) {
+    DataFrame   df;
+    LoadOptions options;
+    options.columns = {"Volume", "Close"};
+    df.load("resources/[fm]*.csv", options);
+    ASSERT_EQ(df.shape, std::make_pair(10, 2));
+    ASSERT_EQ(df.column_at<int64_t>("Volume").string_at(5), "21705200");
+    ASSERT_EQ(df.column_at<double>("Close").count(), 9);
+    ASSERT_THROW(df.load("resources/*.csv"), std::invalid_argument);
+    ASSERT_THROW(df.load("resources/nothing-*.csv"), std::runtime_error);
+
+    // Files guess different types for a column.
+    auto dir = std::filesystem::temp_directory_path() / "luxora-pattern";
+    std::filesystem::create_directories(dir);
+    std::ofstream(dir / "a.csv") << "id,value,text\n1,2,3\n";
+    std::ofstream(dir / "b.csv") << "id,value,text\n2,2.5,x\n";
+    std::ofstream(dir / "c.csv") << "id,value,text\n3,,4\n";
+    std::ofstream(dir / "d.csv") << "id,value,text\n4,1,05\n";
+    df.load((dir / "*.csv").string());
+    ASSERT_EQ(df.column_at<int64_t>("id"), Series<int64_t>({1, 2, 3, 4}));
+    ASSERT_EQ(df.column_at<double>("value"), Series<double>({2.0, 2.5, {}, 1.0}));
+    ASSERT_EQ(df.column_at<std::string>("text"), Series<std::string>({"3", "x", "4", "05"}));
+
+    // An existing file is loaded even if its name looks like a pattern.
+    std::ofstream(dir / "data[1].csv") << "id\n7\n";
+    df.load((dir / "data[1].csv").string());
+    std::filesystem::remove_all(dir);
+    ASSERT_EQ(df.column_at<int64_t>("id"), Series<int64_t>({7}));
+}
+
+TEST(DataFrameTest, ConvertMalformedCells) {
+    std::istringstream iss("Value\n1\nbad\n3\n");
+    DataFrame          df;
+    LoadOptions        options;
+    options.inference = Inference::None;
+    df.load(iss, options);
+    ASSERT_NO_THROW(df.convert_column<float>("Value"));
+    ASSERT_EQ(df.column_at<float>("Value"), Series<float>({1.f, {}, 3.f}));
+}
+
+TEST(DataFrameTest, Categorical) {
+    DataFrame    df("resources/timeseries.csv");
+    Categorical& category = df.categorical_at("Category");
+    ASSERT_EQ(category.categories(), std::vector<std::string>({"A", "B", "C"}));
+    ASSERT_EQ(category.type_size(), 1);
+    ASSERT_EQ(df.rows_equal("Category", "B"), std::vector<size_t>({5, 6, 7, 8, 9}));
+    ASSERT_TRUE(df.rows_equal("Category", "D").empty());
+    ASSERT_EQ(df.rows_equal("Value", "150"), std::vector<size_t>({12}));
+    ASSERT_EQ(df.value_counts("Category"),
+              (std::vector<std::pair<std::string, size_t>>{{"A", 5}, {"B", 5}, {"C", 6}}));
+
+    std::ostringstream saved;
+    df.save(saved);
+    std::ifstream      file("resources/timeseries.csv");
+    std::ostringstream original;
+    original << file.rdbuf();
+    ASSERT_EQ(saved.str(), original.str() + "\n");
+
+    std::istringstream iss("Index,Value,Category,Timestamp\n17,1,B,\n18,2,D,\n19,3,,\n20,4,B,\n");
+    df.append(iss);
+    ASSERT_EQ(df.value_counts("Category"),
+              (std::vector<std::pair<std::string, size_t>>{{"A", 5}, {"B", 7}, {"C", 6}, {"D", 1}}));
+    ASSERT_FALSE(df.categorical_at("Category").valid(18));
+
+    df.convert_column<std::string>("Category", "Text");
+    ASSERT_EQ(df.column_at<std::string>("Text").string_at(19), "B");
+
+    DataFrame   strings;
+    LoadOptions options;
+    options.max_categories = 2;
+    strings.load("resources/timeseries.csv", options);
+    ASSERT_NO_THROW(strings.column_at<std::string>("Category"));
+    ASSERT_THROW(strings.categorical_at("Category"), std::invalid_argument);
+}
@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
 #include <luxora/luxora.h>
 
+#include "compression_test.cpp"
+#include "csv_test.cpp"
 #include "dataframe_test.cpp"
 #include "series_test.cpp"
+#include "simd_test.cpp"
+#include "stream_test.cpp"
 
 using namespace Luxora;
 
@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <functional>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <luxora/categorical.h>
 #include <luxora/series.h>
 #include <string>
 
@@ -97,6 +99,28 @@ TEST(TestSeries, TestMap) {
     concat.map_inplace([](const std::string& s) { return s + std::string("ans"); });
     ASSERT_EQ(concat, Series<std::string>({"18beans", "30beans", "92beans", {}, "20beans"}));
 
+    // Whole blocks of present values and a block with missing ones, callables are called on present values only.
+    std::vector<std::optional<int>> elements(150);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        elements[i] = i % 100 == 99 ? std::optional<int>() : int(i);
+    }
+    Series<int> block(elements);
+    size_t      calls   = 0;
+    Series<int> doubled = block.map<int>([&calls](const int& x) { return ++calls, 2 * x; });
+    ASSERT_EQ(calls, 149);
+    ASSERT_EQ(doubled.values()[128], 256);
+    ASSERT_FALSE(doubled.valid(99));
+    ASSERT_EQ(doubled.values()[99], 0);
+    block.map_inplace([](const int& x) { return x + 1; });
+    ASSERT_EQ(block.values()[149], 150);
+    ASSERT_EQ(block.values()[99], 0);
+    ASSERT_EQ(block.sum(), 150 * 151 / 2 - 100);
+
+    std::function<float(const int&)> erased = [](const int& x) { return float(x); };
+    ASSERT_EQ(series_int.map<float>(erased), series_int.cast<float>());
+    Series<int> tens = series_int.map_option<int>([](const std::optional<int>& x) { return x.value_or(10); });
+    ASSERT_EQ(tens.sum(), 170);
+
     // TODO safe invocation
     // Series<float> erroneous = series_int.map<int>([](const int& x) { return 10 / (x - 30); });
 }
@@ -144,3 +168,276 @@ TEST(TestSeries, Outliers) {
     ASSERT_EQ(outlier_indices.size(), 1);
     ASSERT_EQ(outlier_indices[0], 3);
 }
+
+TEST(TestSeries, TestParse) {
+    Series<std::string> strings({"1", " 2.5 ", "+3", {}, "oops", "1e3"});
+    ASSERT_EQ(strings.parse<double>(), Series<double>({1.0, 2.5, 3.0, {}, {}, 1000.0}));
+    ASSERT_EQ(strings.parse<int>(), Series<int>({1, {}, 3, {}, {}, {}}));
+    ASSERT_EQ(Series<std::string>({"-1", "7"}).parse<size_t>(), Series<size_t>({{}, 7}));
+
+    ASSERT_EQ(string2int("42"), 42);
+    ASSERT_THROW(string2double("4.2x"), std::invalid_argument);
+}
+
+TEST(TestSeries, TestAppend) {
+    Series<int> series({18, 30, {}, 15});
+    ASSERT_EQ(series.quantile(0.5), 18);
+    series.append(Series<int>({92, 1, {}}));
+    ASSERT_EQ(series, Series<int>({18, 30, {}, 15, 92, 1, {}}));
+    ASSERT_EQ(series.quantile(0), 1);
+    ASSERT_EQ(series.quantile(0.8), 92);
+
+    SeriesUntyped& untyped = series;
+    untyped.append(Series<int64_t>({7}));
+    untyped.append(Series<double>({{}, 2.0}));
+    ASSERT_EQ(series.size(), 10);
+    ASSERT_EQ(series.quantile(0.25), 2);
+    ASSERT_EQ(series.quantile(0.5), 15);
+    ASSERT_THROW(untyped.append(Series<std::string>({"a"})), std::invalid_argument);
+}
+
+TEST(TestSeries, TestValidity) {
+    Series<double> series({1.5, {}, 3.0, {}});
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(series.values().data()) % 64, 0);
+    ASSERT_EQ(series.values()[1], 0.0);
+    ASSERT_TRUE(series.valid(0));
+    ASSERT_FALSE(series.valid(3));
+    ASSERT_EQ(series.get_vector(), (std::vector<std::optional<double>>{1.5, {}, 3.0, {}}));
+
+    series.identify_na(3.0);
+    ASSERT_EQ(series.count(), 1);
+    ASSERT_EQ(series, Series<double>({1.5, {}, {}, {}}));
+    series.map_inplace_option([](const std::optional<double>& x) { return x ? std::optional<double>() : 2.0; });
+    ASSERT_EQ(series, Series<double>({{}, 2.0, 2.0, 2.0}));
+    ASSERT_EQ(series.sum(), 6.0);
+
+    // Appending at offsets that are not a multiple of a bitmap word.
+    Bitmap bits(70, true);
+    Bitmap tail(3);
+    tail.set(1, true);
+    bits.append(tail);
+    bits.resize(200, true);
+    ASSERT_EQ(bits.size(), 200);
+    ASSERT_EQ(bits.count(), 198);
+    ASSERT_FALSE(bits[70]);
+    ASSERT_TRUE(bits[71]);
+    ASSERT_FALSE(bits[72]);
+    bits.resize(70);
+    ASSERT_EQ(bits, Bitmap(70, true));
+}
+
+TEST(TestSeries, TestCategorical) {
+    Categorical categories(Series<std::string>({"x", "y", {}, "x"}));
+    ASSERT_EQ(categories.size(), 4);
+    ASSERT_EQ(categories.count(), 3);
+    ASSERT_EQ(categories.string_at(3), "x");
+    ASSERT_EQ(categories.string_at(2), std::nullopt);
+    ASSERT_EQ(categories.counts(), std::vector<size_t>({2, 1}));
+    ASSERT_EQ(categories.decode(), Series<std::string>({"x", "y", {}, "x"}));
+    ASSERT_EQ(Categorical(Series<std::string>({"1.5", "x"})).parse<double>(), Series<double>({1.5, {}}));
+
+    // Codes get wider as the dictionary grows.
+    Series<std::string> many = Series<int>::from_vector(std::vector<int>(300)).map<std::string>(int2string);
+    many.map_inplace([n = 0](const std::string&) mutable { return std::to_string(n++); });
+    Categorical copy = categories;
+    categories.append(std::move(many));
+    ASSERT_EQ(categories.type_size(), 2);
+    ASSERT_EQ(categories.categories().size(), 302);
+    ASSERT_EQ(categories.string_at(303), "299");
+    ASSERT_EQ(copy.categories().size(), 2);
+
+    categories.append(std::move(copy));
+    ASSERT_EQ(categories.indices_of("x"), std::vector<size_t>({0, 3, 304, 307}));
+    ASSERT_THROW(categories.append(Series<int>({1})), std::invalid_argument);
+
+    Series<std::string> text({"a"});
+    text.append(Categorical(Series<std::string>({"b", {}})));
+    ASSERT_EQ(text, Series<std::string>({"a", "b", {}}));
+}
+
+TEST(TestSeries, TestStringArena) {
+    Series<std::string> strings({"alpha", {}, "", "a longer string than fits inline"});
+    ASSERT_EQ(strings.values().size(), 4);
+    ASSERT_EQ(strings.values()[0], "alpha");
+    ASSERT_EQ(strings.values()[1], "");
+    ASSERT_EQ(strings.values().length(), 5 + 32);
+    ASSERT_EQ(strings.string_at(3), "a longer string than fits inline");
+    ASSERT_EQ(strings.max(), "alpha");
+
+    strings.fill_na("none");
+    strings.identify_na("");
+    ASSERT_EQ(strings, Series<std::string>({"alpha", "none", {}, "a longer string than fits inline"}));
+    strings.append(Series<std::string>({"tail"}));
+    ASSERT_EQ(strings.values()[4], "tail");
+    ASSERT_EQ(strings.values().offset(4), strings.values().length());
+}
+
+TEST(TestSeries, Describe) {
+    Series<double> values = {4.0, std::nullopt, 1.0, 7.0, std::nullopt, 2.0};
+    Statistics     stats  = values.describe();
+    ASSERT_EQ(stats.count, 4);
+    ASSERT_EQ(stats.null_count, 2);
+    ASSERT_EQ(stats.sum, 14.0);
+    ASSERT_EQ(stats.mean, 3.5);
+    ASSERT_EQ(stats.min, 1.0);
+    ASSERT_EQ(stats.max, 7.0);
+    ASSERT_NEAR(stats.variance(), values.variance(), 1e-12);
+
+    // Blocks of a long column merge to the statistics of the whole, a shifted mean keeps m2 exact.
+    std::vector<std::optional<int64_t>> elements(5000);
+    Statistics                          added;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (i % 5) {
+            elements[i] = int64_t(1'000'000'000 + i % 11);
+            added.add(double(*elements[i]));
+        }
+    }
+    Series<int64_t> integers(elements);
+    Statistics      described = integers.describe();
+    ASSERT_EQ(described.count, added.count);
+    ASSERT_EQ(described.null_count, 1000);
+    ASSERT_EQ(described.min, 1'000'000'000);
+    ASSERT_EQ(described.max, 1'000'000'010);
+    ASSERT_NEAR(described.mean, added.mean, 1e-6);
+    ASSERT_NEAR(described.variance(), added.variance(), 1e-6);
+
+    // Integers are summed and squared as doubles, wide spreads and large values do not overflow.
+    std::vector<std::optional<int32_t>> spread(2048);
+    for (size_t i = 0; i < spread.size(); ++i) {
+        spread[i] = i % 2 ? 1100 : -1100;
+    }
+    Series<int32_t> spread_series(spread);
+    ASSERT_EQ(spread_series.describe().variance(), 1.21e6);
+    ASSERT_EQ(spread_series.variance(), 1'210'000);
+    ASSERT_EQ(spread_series.stddev(), 1100);
+
+    int64_t                             deviation = 9'110'000'000;
+    std::vector<std::optional<int64_t>> timestamps(4096);
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+        timestamps[i] = 1'700'000'000'000 + (i % 2 ? deviation : -deviation);
+    }
+    Series<int64_t> epochs(timestamps);
+    double          expected = double(deviation) * double(deviation);
+    ASSERT_EQ(epochs.describe().mean, 1.7e12);
+    ASSERT_NEAR(epochs.describe().variance(), expected, expected * 1e-12);
+    ASSERT_EQ(epochs.stddev(), deviation);
+    ASSERT_THROW(epochs.variance(), std::overflow_error);
+
+    Series<int32_t> large = {2'000'000'000, 2'000'000'000};
+    ASSERT_EQ(large.describe().mean, 2e9);
+    ASSERT_EQ(large.mean(), 2'000'000'000);
+    ASSERT_THROW(large.sum(), std::overflow_error);
+
+    Series<long long> fallback = {3, std::nullopt, 5};
+    ASSERT_EQ(fallback.describe().mean, 4.0);
+    ASSERT_EQ(fallback.describe().variance(), 1.0);
+    ASSERT_THROW(Series<double>({std::nullopt}).describe().variance(), std::logic_error);
+}
+
+TEST(TestSeries, QuantileSelection) {
+    std::vector<std::optional<int>> elements;
+    for (int i = 0; i < 1000; ++i) {
+        elements.push_back(i % 9 == 0 ? std::nullopt : std::optional<int>(i * 7919 % 1009));
+    }
+    Series<int>      series(elements);
+    std::vector<int> expected;
+    for (const auto& x : elements) {
+        if (x) {
+            expected.push_back(*x);
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+    // More queries than are selected before sorting, in both directions.
+    for (float q : {0.5f, 0.1f, 0.9f, 0.25f, 0.75f, 0.0f, 1.0f, 0.33f, 0.66f, 0.05f, 0.95f, 0.2f, 0.8f, 0.4f, 0.6f,
+                    0.15f, 0.85f, 0.45f, 0.55f, 0.5f}) {
+        size_t rank = std::min<size_t>(q * expected.size(), expected.size() - 1);
+        ASSERT_EQ(series.quantile(q, OrderMode::Lean), expected[rank]);
+        ASSERT_EQ(series.quantile(q), expected[rank]);
+    }
+
+    // Changed values drop partially ordered ones.
+    Series<int> changed({5, 1, 4, {}, 2});
+    ASSERT_EQ(changed.quantile(0.5), 4);
+    changed.map_inplace([](const int& x) { return -x; });
+    ASSERT_EQ(changed.quantile(0.5), -2);
+    changed.append(Series<int>({-10, -20}));
+    ASSERT_EQ(changed.quantile(0), -20);
+    ASSERT_EQ(changed.median(), -4);
+    ASSERT_THROW(Series<int>({std::nullopt}).quantile(0.5), std::logic_error);
+}
+
+TEST(TestSeries, Quantiles) {
+    Series<double>      series({9, 1, {}, 8, 2, 7, 3, 6, 4, 5, 10});
+    std::vector<float>  qs       = {0.9f, 0.1f, 0.5f, 0.1f, 1.0f};
+    std::vector<double> expected = {10, 2, 6, 2, 10};
+    ASSERT_EQ(series.quantiles(qs, OrderMode::Lean), expected);
+    ASSERT_EQ(series.quantiles(qs), expected);
+    ASSERT_EQ(series.quantiles(qs), expected);
+    ASSERT_EQ(series.median(), 5.5);
+    ASSERT_EQ(series.iqr(), 5);
+    ASSERT_TRUE(series.quantiles({}).empty());
+}
+
+TEST(TestSeries, QuantileSketch) {
+    std::vector<std::optional<double>> elements(100000);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (i % 10) {
+            elements[i] = double(i * 7919 % 100003);
+        }
+    }
+    Series<double> series(elements);
+    QuantileSketch whole = series.sketch();
+    ASSERT_EQ(whole.count(), series.count());
+    ASSERT_LT(whole.size(), 1000);
+
+    // Sketches of two halves merge into one of the whole column.
+    QuantileSketch first, second;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (elements[i]) {
+            (i < elements.size() / 2 ? first : second).add(*elements[i]);
+        }
+    }
+    first.merge(second);
+    ASSERT_EQ(first.count(), series.count());
+    for (float q : {0.01f, 0.25f, 0.5f, 0.75f, 0.99f}) {
+        double exact = series.quantile(q);
+        ASSERT_NEAR(whole.quantile(q), exact, 0.02 * 100003);
+        ASSERT_NEAR(first.quantile(q), exact, 0.02 * 100003);
+    }
+    ASSERT_THROW(QuantileSketch().quantile(0.5), std::logic_error);
+}
+
+TEST(TestSeries, CachedStatistics) {
+    Series<int> series({4, {}, 1, 7, {}});
+    ASSERT_EQ(series.mean(), 4);
+    ASSERT_EQ(series.max(), 7);
+
+    // Changes after the statistics were cached are seen by the next query.
+    series.fill_na(10);
+    ASSERT_EQ(series.count(), 5);
+    ASSERT_EQ(series.sum(), 32);
+    ASSERT_EQ(series.max(), 10);
+    ASSERT_EQ(series.describe().null_count, 0);
+    ASSERT_NEAR(series.describe().variance(), Series<int>({4, 1, 7, 10, 10}).describe().variance(), 1e-12);
+
+    series.map_inplace([](const int& x) { return -x; });
+    ASSERT_EQ(series.min(), -10);
+    series.identify_na(-10);
+    ASSERT_EQ(series.count(), 3);
+    ASSERT_EQ(series.sum(), -12);
+
+    series.append(Series<int>({20, {}}));
+    ASSERT_EQ(series.count(), 4);
+    ASSERT_EQ(series.sum(), 8);
+    ASSERT_EQ(series.max(), 20);
+    ASSERT_EQ(series.describe().null_count, 3);
+    ASSERT_EQ(series.sketch().count(), 4);
+    series.append(Series<int>({30}));
+    ASSERT_EQ(series.sketch().count(), 5);
+    ASSERT_EQ(series.sketch().quantile(1), 30);
+
+    Series<int> copy = series;
+    copy.fill_na(0);
+    ASSERT_EQ(series.count(), 5);
+    ASSERT_EQ(copy.count(), 8);
+}
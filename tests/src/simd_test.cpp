@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <luxora/bitmap.h>
+#include <luxora/simd.h>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace Luxora;
+
+TEST(SimdTest, ScanBlockLevels) {
+    std::string block = "1,100,A,\"2024-01-01 12:00:00\"\r\n2,105,A,2024-01-01 13:00:00\n3,110,B";
+    block.resize(scan_block_size, 'x');
+    StructuralMasks expected = scan_block(block.data(), ',', SimdLevel::Scalar);
+    ASSERT_EQ(expected.delimiter & 0xFF, 0b10100010);
+    ASSERT_EQ(expected.quote & (uint64_t(1) << 8), uint64_t(1) << 8);
+    for (auto level : {SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > simd_level()) {
+            continue;
+        }
+        StructuralMasks masks = scan_block(block.data(), ',', level);
+        ASSERT_EQ(masks.delimiter, expected.delimiter);
+        ASSERT_EQ(masks.quote, expected.quote);
+        ASSERT_EQ(masks.newline, expected.newline);
+    }
+}
+
+TEST(SimdTest, Scanner) {
+    std::string text(150, 'a');
+    text[3]   = ';';
+    text[70]  = '"';
+    text[149] = '\n';
+    StructuralScanner scanner(text, ';');
+    const char*       begin = text.data();
+    ASSERT_EQ(scanner.next(begin) - begin, 3);
+    ASSERT_EQ(scanner.next(begin + 3) - begin, 3);
+    ASSERT_EQ(scanner.next(begin + 4) - begin, 70);
+    ASSERT_EQ(scanner.next(begin + 71) - begin, 149);
+    ASSERT_EQ(scanner.next(begin + 150) - begin, 150);
+
+    StructuralScanner none(std::string_view(text).substr(0, 3), ';');
+    ASSERT_EQ(none.next(begin) - begin, 3);
+}
+
+template <typename T>
+void check_reductions() {
+    // Two full words and a tail, every third value and all of the second word but one are missing.
+    size_t         n = 150;
+    std::vector<T> values(n);
+    Bitmap         validity(n);
+    for (size_t i = 0; i < n; ++i) {
+        if (i % 3 && (i < 64 || i >= 128 || i == 100)) {
+            values[i] = T(i % 7 == 0 ? 200 - i : i / 2);
+            validity.set(i, true);
+        }
+    }
+    values[99] = 0;
+    Aggregates<T> expected = aggregate(values.data(), validity.data(), n, SimdLevel::Scalar);
+    ASSERT_EQ(expected.count, validity.count());
+    ASSERT_EQ(expected.min, T(0));
+    ASSERT_EQ(expected.max, T(193));
+    SumType<T> deviations = squared_deviations(values.data(), validity.data(), n, SumType<T>(30), SimdLevel::Scalar);
+    for (auto level : {SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > simd_level()) {
+            continue;
+        }
+        for (size_t size : {n, size_t(64), size_t(5)}) {
+            Aggregates<T> scalar = aggregate(values.data(), validity.data(), size, SimdLevel::Scalar);
+            Aggregates<T> res    = aggregate(values.data(), validity.data(), size, level);
+            ASSERT_EQ(res.count, scalar.count);
+            ASSERT_EQ(res.sum, scalar.sum);
+            ASSERT_EQ(res.min, scalar.min);
+            ASSERT_EQ(res.max, scalar.max);
+        }
+        ASSERT_EQ(squared_deviations(values.data(), validity.data(), n, SumType<T>(30), level), deviations);
+    }
+}
+
+TEST(SimdTest, Reductions) {
+    check_reductions<float>();
+    check_reductions<double>();
+    check_reductions<int32_t>();
+    check_reductions<int64_t>();
+    check_reductions<size_t>();
+
+    // Negative values, and nothing present.
+    std::vector<int64_t> values = {-5, 0, -9, 3};
+    Bitmap               validity(4, true);
+    validity.set(1, false);
+    Aggregates<int64_t> res = aggregate(values.data(), validity.data(), values.size());
+    ASSERT_EQ(res.min, -9);
+    ASSERT_EQ(res.max, 3);
+    ASSERT_EQ(res.sum, -11);
+    Aggregates<int64_t> none = aggregate(values.data(), Bitmap(4).data(), values.size());
+    ASSERT_EQ(none.count, 0);
+    ASSERT_EQ(none.min, std::numeric_limits<int64_t>::max());
+
+    // 64 bit integers beyond 32 bits widen to doubles exactly, sums would overflow them.
+    std::vector<int64_t> wide(64);
+    std::vector<size_t>  unsigned_wide(64);
+    for (size_t i = 0; i < wide.size(); ++i) {
+        wide[i]          = (int64_t(i) - 32) * (int64_t(1) << 57);
+        unsigned_wide[i] = i * (size_t(1) << 58);
+    }
+    Bitmap all(64, true);
+    for (auto level : {SimdLevel::Scalar, SimdLevel::SSE42, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (level > simd_level()) {
+            continue;
+        }
+        ASSERT_EQ(aggregate(wide.data(), all.data(), wide.size(), level).sum, -32 * std::ldexp(1.0, 57));
+        ASSERT_EQ(aggregate(unsigned_wide.data(), all.data(), unsigned_wide.size(), level).sum,
+                  2016 * std::ldexp(1.0, 58));
+    }
+}
@@ -0,0 +1,85 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <luxora/dataframe.h>
+#include <luxora/stream.h>
+#include <sstream>
+#include <stdexcept>
+
+using namespace Luxora;
+
+TEST(StreamTest, StatsMatchInMemory) {
+    DataFrame df("resources/timeseries.csv");
+    df.convert_column<double>("Value");
+    Series<double>& values = df.column_at<double>("Value");
+
+    Stream      stream("resources/timeseries.csv", 3);
+    StreamStats stats = stream.stats("Value");
+    ASSERT_EQ(stats.count, 16);
+    ASSERT_EQ(stats.null_count, 0);
+    ASSERT_EQ(stats.sum, values.sum());
+    ASSERT_EQ(stats.min, values.min());
+    ASSERT_EQ(stats.max, values.max());
+    ASSERT_NEAR(stats.mean, values.mean(), 1e-9);
+    ASSERT_NEAR(stats.variance(), values.variance(), 1e-6);
+
+    StreamStats missing = Stream("resources/missing.csv", 2).stats("Close");
+    ASSERT_EQ(missing.count, 4);
+    ASSERT_EQ(missing.null_count, 1);
+}
+
+TEST(StreamTest, NormalizeMatchesInMemory) {
+    DataFrame df("resources/missing.csv");
+    df.convert_column<double>("Volume");
+    df.normalize<double>("Volume", "VolumeNorm");
+    std::ostringstream expected;
+    df.save(expected);
+
+    std::ostringstream streamed;
+    Stream("resources/missing.csv", 2).normalize("Volume", "VolumeNorm").save(streamed);
+    ASSERT_EQ(streamed.str(), expected.str());
+}
+
+TEST(StreamTest, PlannedPasses) {
+    DataFrame df("resources/missing.csv");
+    df.convert_column<double>("Close");
+    df.fill_na("Close", Strategy::Mean);
+    df.normalize<double>("Close", "", Zscore);
+    std::ostringstream expected;
+    df.save(expected);
+
+    // Z-score of Close has to see values imputed by the previous step.
+    std::ostringstream streamed;
+    Stream             stream("resources/missing.csv", 2);
+    stream.fill_na("Close").normalize("Close", "", Zscore).save(streamed);
+    ASSERT_EQ(streamed.str(), expected.str());
+    ASSERT_NEAR(stream.stats("Close").mean, 0, 1e-6);
+
+    ASSERT_THROW(stream.fill_na("Close", Strategy::Median), std::invalid_argument);
+}
+
+TEST(StreamTest, ApproximateOutliers) {
+    DataFrame df("resources/timeseries.csv");
+    df.convert_column<double>("Value");
+    std::vector<double> expected = df.outliers<double>("Value");
+    ASSERT_EQ(df.outliers<double>("Value", true), expected);
+
+    // Few values fit the sketch as they are, so quartiles of merged batches are exact.
+    Stream stream("resources/timeseries.csv", 3);
+    ASSERT_EQ(stream.sketch("Value").count(), 16);
+    ASSERT_EQ(stream.sketch("Value").quantile(0.5), df.column_at<double>("Value").quantile(0.5));
+    ASSERT_EQ(stream.outliers("Value"), expected);
+}
+
+TEST(StreamTest, TypesOfAllBatches) {
+    // Column a looks like integers in the first batch and has a fraction in the second.
+    auto path = std::filesystem::temp_directory_path() / "luxora-stream-types.csv";
+    std::ofstream(path) << "a,b\n1,x\n2,y\n3.5,z\n4,w\n5,q\n6,r\n";
+    std::ostringstream streamed;
+    Stream(path, 2).save(streamed);
+    LoadOptions unknown;
+    unknown.columns = {"Nope"};
+    ASSERT_THROW(Stream(path, 2, unknown), std::invalid_argument);
+    std::filesystem::remove(path);
+    ASSERT_EQ(streamed.str(), "a,b\n1.000000,x\n2.000000,y\n3.500000,z\n4.000000,w\n5.000000,q\n6.000000,r\n");
+}